@@ -6,6 +6,8 @@
 
 #include <math.h>
 
+#include "3rdparty/doctest.h"
+
 int Base64Converter::default_base64_table[256];
 const string Base64Converter::default_alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -179,6 +181,32 @@ int Base64Converter::Decode(int len, const char* data, int* pblen, char** pbuf)
 			base64_padding = 0;
 			}
 
+		if ( base64_group_next == 0 && ! base64_after_padding )
+			{
+			// Fast path: decode whole groups of four valid,
+			// unpadded characters without going through the
+			// group state.
+			while ( len - dlen >= 4 && buf + 3 <= *pbuf + blen )
+				{
+				const unsigned char* p = (const unsigned char*) data + dlen;
+				int k0 = base64_table[p[0]];
+				int k1 = base64_table[p[1]];
+				int k2 = base64_table[p[2]];
+				int k3 = base64_table[p[3]];
+
+				if ( (k0 | k1 | k2 | k3) < 0 ||
+				     p[2] == '=' || p[3] == '=' ||
+				     p[0] == '=' || p[1] == '=' )
+					break;
+
+				uint32_t bit32 = (k0 << 18) | (k1 << 12) | (k2 << 6) | k3;
+				*buf++ = char((bit32 >> 16) & 0xff);
+				*buf++ = char((bit32 >> 8) & 0xff);
+				*buf++ = char((bit32) & 0xff);
+				dlen += 4;
+				}
+			}
+
 		if ( dlen >= len )
 			break;
 
@@ -228,6 +256,39 @@ void Base64Converter::IllegalEncoding(const char* msg)
 			reporter->Error("%s", msg);
 		}
 
+TEST_CASE("base64 decode")
+	{
+	Base64Converter dec(0);
+
+	const char* in = "SGVsbG8sIHdvcmxkIQ==";
+	char out[32];
+	char* pout = out;
+	int olen = sizeof(out);
+	CHECK(dec.Decode(strlen(in), in, &olen, &pout) == int(strlen(in)));
+	CHECK(std::string(out, olen) == "Hello, world!");
+
+	// Input split inside a group.
+	Base64Converter split(0);
+	const char* part1 = "Zm9vYm";
+	const char* part2 = "FyYmF6";
+	char* p = out;
+	int n1 = sizeof(out);
+	split.Decode(strlen(part1), part1, &n1, &p);
+	p = out + n1;
+	int n2 = sizeof(out) - n1;
+	split.Decode(strlen(part2), part2, &n2, &p);
+	CHECK(std::string(out, n1 + n2) == "foobarbaz");
+
+	// Output space runs out in the middle of the input.
+	Base64Converter small(0);
+	const char* abc = "YWJjZGVm";
+	char buf3[3];
+	char* pb = buf3;
+	int blen = sizeof(buf3);
+	CHECK(small.Decode(strlen(abc), abc, &blen, &pb) == 8);
+	CHECK(std::string(buf3, blen) == "abc");
+	}
+
 BroString* decode_base64(const BroString* s, const BroString* a, Connection* conn)
 	{
 	if ( a && a->Len() != 0 && a->Len() != 64 )
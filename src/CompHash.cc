@@ -52,7 +52,12 @@ CompositeHash::CompositeHash(TypeList* composite_type)
 		{
 		size = ComputeKeySize(0, 1, true);
 
-		if ( size > 0 )
+		if ( size > 0 && BuildFixedLayout() )
+			// ComputeFixedHash() builds keys in their own
+			// allocation, so no scratch space is needed.
+			key = 0;
+
+		else if ( size > 0 )
 			// Fixed size.  Make sure what we get is fully aligned.
 			key = reinterpret_cast<char*>
 				(new double[size/sizeof(double) + 1]);
@@ -67,6 +72,61 @@ CompositeHash::~CompositeHash()
 	delete [] key;
 	}
 
+bool CompositeHash::BuildFixedLayout()
+	{
+	if ( is_complex_type )
+		return false;
+
+	const type_list* tl = type->Types();
+	std::vector<FixedKeyField> fields;
+	int sz = 0;
+
+	for ( const auto& t : *tl )
+		{
+		unsigned int align;
+		unsigned int width;
+
+		switch ( t->InternalType() ) {
+		case TYPE_INTERNAL_INT:
+			align = width = sizeof(bro_int_t);
+			break;
+
+		case TYPE_INTERNAL_UNSIGNED:
+			align = width = sizeof(bro_uint_t);
+			break;
+
+		case TYPE_INTERNAL_DOUBLE:
+			align = width = sizeof(double);
+			break;
+
+		case TYPE_INTERNAL_ADDR:
+			align = sizeof(uint32_t);
+			width = 4 * sizeof(uint32_t);
+			break;
+
+		case TYPE_INTERNAL_SUBNET:
+			align = sizeof(uint32_t);
+			width = 5 * sizeof(uint32_t);
+			break;
+
+		default:
+			return false;
+		}
+
+		// Same rounding as SizeAlign(), so that keys are
+		// byte-for-byte identical to those of SingleValHash().
+		int offset = (sz + align - 1) & ~(align - 1);
+		fields.push_back({t->InternalType(), offset});
+		sz = offset + width;
+		}
+
+	if ( sz != size )
+		return false;
+
+	fixed_fields = std::move(fields);
+	return true;
+	}
+
 // Computes the piece of the hash for Val*, returning the new kp.
 char* CompositeHash::SingleValHash(int type_check, char* kp0,
 				   BroType* bt, Val* v, bool optional) const
@@ -346,6 +406,9 @@ HashKey* CompositeHash::ComputeHash(const Val* v, int type_check) const
 	if ( is_singleton )
 		return ComputeSingletonHash(v, type_check);
 
+	if ( ! fixed_fields.empty() )
+		return ComputeFixedHash(v, type_check);
+
 	if ( is_complex_type && v->Type()->Tag() != TYPE_LIST )
 		{
 		ListVal lv(TYPE_ANY);
@@ -453,6 +516,68 @@ HashKey* CompositeHash::ComputeSingletonHash(const Val* v, int type_check) const
 	}
 	}
 
+HashKey* CompositeHash::ComputeFixedHash(const Val* v, int type_check) const
+	{
+	if ( type_check && v->Type()->Tag() != TYPE_LIST )
+		return 0;
+
+	const val_list* vl = v->AsListVal()->Vals();
+	int n = fixed_fields.size();
+
+	if ( type_check && vl->length() != n )
+		return 0;
+
+	// Allocate as doubles so that the key is fully aligned, and
+	// zero it so that any padding between fields is deterministic.
+	char* k = reinterpret_cast<char*>(new double[size/sizeof(double) + 1]);
+	memset(k, 0, size);
+
+	for ( int i = 0; i < n; ++i )
+		{
+		const Val* vi = (*vl)[i];
+		const FixedKeyField& f = fixed_fields[i];
+		char* kp = k + f.offset;
+
+		if ( type_check && vi->Type()->InternalType() != f.tag )
+			{
+			delete [] reinterpret_cast<double*>(k);
+			return 0;
+			}
+
+		switch ( f.tag ) {
+		case TYPE_INTERNAL_INT:
+			*reinterpret_cast<bro_int_t*>(kp) = vi->ForceAsInt();
+			break;
+
+		case TYPE_INTERNAL_UNSIGNED:
+			*reinterpret_cast<bro_uint_t*>(kp) = vi->ForceAsUInt();
+			break;
+
+		case TYPE_INTERNAL_DOUBLE:
+			*reinterpret_cast<double*>(kp) = vi->InternalDouble();
+			break;
+
+		case TYPE_INTERNAL_ADDR:
+			vi->AsAddr().CopyIPv6(reinterpret_cast<uint32_t*>(kp));
+			break;
+
+		case TYPE_INTERNAL_SUBNET:
+			{
+			uint32_t* skp = reinterpret_cast<uint32_t*>(kp);
+			vi->AsSubNet().Prefix().CopyIPv6(skp);
+			skp[4] = vi->AsSubNet().Length();
+			}
+			break;
+
+		default:
+			reporter->InternalError("bad index type in CompositeHash::ComputeFixedHash");
+			return 0;
+		}
+		}
+
+	return new HashKey(false, (void*) k, size);
+	}
+
 int CompositeHash::SingleTypeKeySize(BroType* bt, const Val* v,
 				     int type_check, int sz, bool optional,
 				     bool calc_static_size) const
@@ -4,6 +4,8 @@
 
 #include "Type.h"
 
+#include <vector>
+
 class ListVal;
 class HashKey;
 
@@ -24,6 +26,17 @@ public:
 protected:
 	HashKey* ComputeSingletonHash(const Val* v, int type_check) const;
 
+	// Used instead of the general recursive path when every index
+	// type has a fixed-size atomic representation (e.g., [addr, port]
+	// or [addr, addr, count]).  The key layout is computed once in
+	// the constructor, so here we only store each value at its
+	// precomputed offset.
+	HashKey* ComputeFixedHash(const Val* v, int type_check) const;
+
+	// Fills in fixed_fields if the index type qualifies for
+	// ComputeFixedHash(), returning true if so.
+	bool BuildFixedLayout();
+
 	// Computes the piece of the hash for Val*, returning the new kp.
 	// Used as a helper for ComputeHash in the non-singleton case.
 	char* SingleValHash(int type_check, char* kp, BroType* bt, Val* v,
@@ -87,4 +100,13 @@ protected:
 	int is_complex_type;
 
 	InternalTypeTag singleton_tag;
+
+	// Precomputed key layout for ComputeFixedHash(); empty if the
+	// index type doesn't have one.
+	struct FixedKeyField {
+		InternalTypeTag tag;
+		int offset;
+	};
+
+	std::vector<FixedKeyField> fixed_fields;
 };
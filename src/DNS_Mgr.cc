@@ -846,7 +846,16 @@ void DNS_Mgr::AddResult(DNS_Mgr_Request* dr, struct nb_dns_result* r)
 	if ( keep_prev )
 		delete new_dm;
 	else
+		{
+		if ( ! dr->ReqHost() )
+			ScheduleExpiration(new_dm, CACHE_ADDR);
+		else if ( dr->ReqIsTxt() )
+			ScheduleExpiration(new_dm, CACHE_TEXT);
+		else
+			ScheduleExpiration(new_dm, CACHE_HOST);
+
 		delete prev_dm;
+		}
 	}
 
 void DNS_Mgr::CompareMappings(DNS_Mapping* prev_dm, DNS_Mapping* new_dm)
@@ -947,19 +956,20 @@ void DNS_Mgr::LoadCache(FILE* f)
 		{
 		if ( m->ReqHost() )
 			{
-			if ( host_mappings.find(m->ReqHost()) == host_mappings.end() )
-				{
-				host_mappings[m->ReqHost()].first = 0;
-				host_mappings[m->ReqHost()].second = 0;
-				}
+			// A new entry starts out with both mappings null.
+			auto& hm = host_mappings[m->ReqHost()];
+
 			if ( m->Type() == AF_INET )
-				host_mappings[m->ReqHost()].first = m;
+				hm.first = m;
 			else
-				host_mappings[m->ReqHost()].second = m;
+				hm.second = m;
+
+			ScheduleExpiration(m, CACHE_HOST);
 			}
 		else
 			{
 			addr_mappings[m->ReqAddr()] = m;
+			ScheduleExpiration(m, CACHE_ADDR);
 			}
 		}
 
@@ -993,6 +1003,91 @@ void DNS_Mgr::Save(FILE* f, const HostMap& m)
 		}
 	}
 
+void DNS_Mgr::ScheduleExpiration(const DNS_Mapping* dm, CacheKind kind)
+	{
+	// When priming or working off a saved cache, entries need to stay
+	// around regardless of their TTL.
+	if ( mode != DNS_DEFAULT )
+		return;
+
+	// Mirrors DNS_Mapping::Expired().
+	if ( dm->req_host && dm->num_addrs == 0 )
+		return;
+
+	CacheExpiration e;
+	e.time = dm->creation_time + dm->req_ttl;
+	e.kind = kind;
+
+	if ( dm->req_host )
+		e.host = dm->req_host;
+	else
+		e.addr = dm->req_addr;
+
+	cache_expirations.push(std::move(e));
+	}
+
+void DNS_Mgr::ExpireMappings()
+	{
+	double now = current_time();
+
+	while ( ! cache_expirations.empty() )
+		{
+		const CacheExpiration& e = cache_expirations.top();
+
+		if ( e.time >= now )
+			break;
+
+		switch ( e.kind ) {
+		case CACHE_ADDR:
+			{
+			auto it = addr_mappings.find(e.addr);
+
+			if ( it != addr_mappings.end() && it->second->Expired() )
+				{
+				delete it->second;
+				addr_mappings.erase(it);
+				}
+			}
+			break;
+
+		case CACHE_TEXT:
+			{
+			auto it = text_mappings.find(e.host);
+
+			if ( it != text_mappings.end() && it->second->Expired() )
+				{
+				delete it->second;
+				text_mappings.erase(it);
+				}
+			}
+			break;
+
+		case CACHE_HOST:
+			{
+			auto it = host_mappings.find(e.host);
+
+			if ( it == host_mappings.end() )
+				break;
+
+			DNS_Mapping* d4 = it->second.first;
+			DNS_Mapping* d6 = it->second.second;
+
+			// Like LookupNameInCache(), drop the pair once
+			// either of them has expired.
+			if ( (d4 && d4->Expired()) || (d6 && d6->Expired()) )
+				{
+				delete d4;
+				delete d6;
+				host_mappings.erase(it);
+				}
+			}
+			break;
+		}
+
+		cache_expirations.pop();
+		}
+	}
+
 const char* DNS_Mgr::LookupAddrInCache(const IPAddr& addr)
 	{
 	AddrMap::iterator it = addr_mappings.find(addr);
@@ -1402,9 +1497,16 @@ void DNS_Mgr::Process()
 		delete req;
 		}
 
-	if ( AnswerAvailable(0) <= 0 )
-		return;
+	ExpireMappings();
 
+	// Handle all replies that have arrived, not just the first, so that
+	// a burst of answers doesn't have to wait for further Process() calls.
+	for ( int i = 0; i < MAX_PENDING_REQUESTS && AnswerAvailable(0) > 0; ++i )
+		ProcessAnswer();
+	}
+
+void DNS_Mgr::ProcessAnswer()
+	{
 	char err[NB_DNS_ERRSIZE];
 	struct nb_dns_result r;
 
@@ -5,6 +5,7 @@
 #include <list>
 #include <map>
 #include <queue>
+#include <unordered_map>
 #include <utility>
 
 #include "List.h"
@@ -106,13 +107,37 @@ protected:
 	ListVal* AddrListDelta(ListVal* al1, ListVal* al2);
 	void DumpAddrList(FILE* f, ListVal* al);
 
-	typedef map<string, pair<DNS_Mapping*, DNS_Mapping*> > HostMap;
-	typedef map<IPAddr, DNS_Mapping*> AddrMap;
-	typedef map<string, DNS_Mapping*> TextMap;
+	struct AddrHash {
+		size_t operator()(const IPAddr& a) const
+			{
+			uint32_t w[4];
+			a.CopyIPv6(w);
+			uint64_t h = ((uint64_t(w[0]) << 32) | w[1]) * 0x9e3779b97f4a7c15ULL;
+			h ^= (uint64_t(w[2]) << 32) | w[3];
+			h *= 0xbf58476d1ce4e5b9ULL;
+			return h ^ (h >> 31);
+			}
+	};
+
+	typedef std::unordered_map<string, pair<DNS_Mapping*, DNS_Mapping*> > HostMap;
+	typedef std::unordered_map<IPAddr, DNS_Mapping*, AddrHash> AddrMap;
+	typedef std::unordered_map<string, DNS_Mapping*> TextMap;
 	void LoadCache(FILE* f);
 	void Save(FILE* f, const AddrMap& m);
 	void Save(FILE* f, const HostMap& m);
 
+	enum CacheKind { CACHE_HOST, CACHE_ADDR, CACHE_TEXT };
+
+	// Queues the mapping for removal from the given cache once its
+	// TTL has passed.
+	void ScheduleExpiration(const DNS_Mapping* dm, CacheKind kind);
+
+	// Removes all cached mappings whose TTL has passed.
+	void ExpireMappings();
+
+	// Handles one reply from nb_dns.
+	void ProcessAnswer();
+
 	// Selects on the fd to see if there is an answer available (timeout
 	// is secs). Returns 0 on timeout, -1 on EINTR or other error, and 1
 	// if answer is ready.
@@ -233,6 +258,26 @@ protected:
 
 	int asyncs_pending;
 
+	// Cache entries in order of expiration.  When a mapping gets
+	// replaced, its entry stays queued and ExpireMappings() skips it
+	// because the current mapping hasn't expired yet.
+	struct CacheExpiration {
+		double time;
+		CacheKind kind;
+		string host;
+		IPAddr addr;
+	};
+
+	struct CacheExpirationCompare {
+		bool operator()(const CacheExpiration& a, const CacheExpiration& b)
+			{
+			return a.time > b.time;
+			}
+	};
+
+	typedef priority_queue<CacheExpiration, std::vector<CacheExpiration>, CacheExpirationCompare> ExpirationQueue;
+	ExpirationQueue cache_expirations;
+
 	unsigned long num_requests;
 	unsigned long successful;
 	unsigned long failed;
@@ -9,6 +9,8 @@
 #include "Sessions.h"
 #include "Reporter.h"
 
+#include <algorithm>
+
 #define MIN_ACCEPTABLE_FRAG_SIZE 64
 #define MAX_ACCEPTABLE_FRAG_SIZE 64000
 
@@ -50,9 +52,15 @@ FragReassembler::FragReassembler(NetSessions* arg_s,
 		}
 
 	reassembled_pkt = 0;
+	reassembled_len = 0;
 	frag_size = 0;	// flag meaning "not known"
 	next_proto = ip->NextProto();
 
+	fast_path = true;
+	fast_buf = 0;
+	fast_len = 0;
+	fast_cap = 0;
+
 	if ( frag_timeout != 0.0 )
 		{
 		expire_timer = new FragTimer(this, t + frag_timeout);
@@ -68,6 +76,8 @@ FragReassembler::~FragReassembler()
 	{
 	DeleteTimer();
 	delete [] proto_hdr;
+	delete [] fast_buf;
+	SetFastCap(0);
 	delete reassembled_pkt;
 	}
 
@@ -152,9 +162,102 @@ void FragReassembler::AddFragment(double t, const IP_Hdr* ip, const u_char* pkt)
 	pkt += hdr_len;
 	len -= hdr_len;
 
+	if ( reassembled_pkt )
+		{
+		CheckLateFragment(offset, len, pkt);
+		return;
+		}
+
+	if ( fast_path && AddFast(offset, len, pkt) )
+		return;
+
 	NewBlock(network_time, offset, len, pkt);
 	}
 
+bool FragReassembler::AddFast(uint64_t offset, uint32_t len, const u_char* data)
+	{
+	if ( offset != fast_len )
+		{
+		fast_path = false;
+
+		if ( fast_len )
+			NewBlock(network_time, 0, fast_len, fast_buf + proto_hdr_len);
+
+		delete [] fast_buf;
+		fast_buf = 0;
+		SetFastCap(0);
+		return false;
+		}
+
+	if ( fast_len + len > fast_cap )
+		{
+		// Unless this already is the last fragment, leave room
+		// for two more of the same size.
+		uint64_t cap = fast_len + len;
+
+		if ( ! frag_size )
+			cap += 2 * len;
+		else if ( frag_size > cap )
+			cap = frag_size;
+
+		u_char* buf = new u_char[proto_hdr_len + cap];
+
+		if ( fast_buf )
+			memcpy(buf, fast_buf, proto_hdr_len + fast_len);
+		else
+			memcpy(buf, proto_hdr, proto_hdr_len);
+
+		delete [] fast_buf;
+		fast_buf = buf;
+		SetFastCap(cap);
+		}
+
+	memcpy(fast_buf + proto_hdr_len + fast_len, data, len);
+	fast_len += len;
+
+	if ( frag_size && fast_len >= frag_size )
+		{
+		if ( fast_len > frag_size )
+			{
+			Weird("fragment_size_inconsistency");
+			frag_size = fast_len;
+			}
+
+		u_char* pkt = fast_buf;
+		fast_buf = 0;
+		fast_path = false;
+		SetFastCap(0);
+		Reassembled(pkt, proto_hdr_len + frag_size);
+		}
+
+	return true;
+	}
+
+void FragReassembler::SetFastCap(uint64_t cap)
+	{
+	Reassembler::total_size += cap - fast_cap;
+	Reassembler::sizes[rtype] += cap - fast_cap;
+	fast_cap = cap;
+	}
+
+void FragReassembler::CheckLateFragment(uint64_t offset, uint32_t len,
+                                        const u_char* data)
+	{
+	// The datagram is complete and may still be being processed, so
+	// rather than reassembling it anew, which would replace
+	// reassembled_pkt, just compare the fragment against it.
+	const u_char* pkt_start = reassembled_pkt->IP4_Hdr() ?
+		(const u_char*) reassembled_pkt->IP4_Hdr() :
+		(const u_char*) reassembled_pkt->IP6_Hdr();
+
+	if ( offset >= reassembled_len )
+		// Beyond the end, AddFragment() has already complained.
+		return;
+
+	uint64_t n = std::min(uint64_t(len), reassembled_len - offset);
+	Overlap(pkt_start + proto_hdr_len + offset, data, n);
+	}
+
 void FragReassembler::Weird(const char* name) const
 	{
 	unsigned int version = ((const ip*)proto_hdr)->ip_v;
@@ -284,6 +387,11 @@ void FragReassembler::BlockInserted(DataBlockMap::const_iterator /* it */)
 		memcpy(&pkt[b.seq], b.block, b.upper - b.seq);
 		}
 
+	Reassembled(pkt_start, n);
+	}
+
+void FragReassembler::Reassembled(u_char* pkt_start, uint64_t n)
+	{
 	delete reassembled_pkt;
 	reassembled_pkt = 0;
 
@@ -294,6 +402,7 @@ void FragReassembler::BlockInserted(DataBlockMap::const_iterator /* it */)
 		struct ip* reassem4 = (struct ip*) pkt_start;
 		reassem4->ip_len = htons(frag_size + proto_hdr_len);
 		reassembled_pkt = new IP_Hdr(reassem4, true);
+		reassembled_len = n - proto_hdr_len;
 		DeleteTimer();
 		}
 
@@ -303,6 +412,7 @@ void FragReassembler::BlockInserted(DataBlockMap::const_iterator /* it */)
 		reassem6->ip6_plen = htons(frag_size + proto_hdr_len - 40);
 		const IPv6_Hdr_Chain* chain = new IPv6_Hdr_Chain(reassem6, next_proto, n);
 		reassembled_pkt = new IP_Hdr(reassem6, true, n, chain);
+		reassembled_len = n - proto_hdr_len;
 		DeleteTimer();
 		}
 
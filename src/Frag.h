@@ -7,6 +7,7 @@
 #include "Reassem.h"
 #include "Timer.h"
 
+#include <list>
 #include <tuple>
 
 #include <sys/types.h> // for u_char
@@ -37,19 +38,54 @@ public:
 	const IP_Hdr* ReassembledPkt()	{ return reassembled_pkt; }
 	const FragReassemblerKey& Key() const	{ return key; }
 
+	// Position in NetSessions' list of pending reassemblers, oldest
+	// first, or the list's end once the datagram is complete.
+	std::list<FragReassembler*>::iterator AgePos() const	{ return age_pos; }
+	void SetAgePos(std::list<FragReassembler*>::iterator pos)	{ age_pos = pos; }
+
 protected:
 	void BlockInserted(DataBlockMap::const_iterator it) override;
 	void Overlap(const u_char* b1, const u_char* b2, uint64_t n) override;
 	void Weird(const char* name) const;
 
+	// Appends an in-order fragment to fast_buf.  Returns false, after
+	// handing everything collected so far to the generic reassembler,
+	// if the fragment doesn't start where the previous one ended.
+	bool AddFast(uint64_t offset, uint32_t len, const u_char* data);
+
+	// Sets fast_cap and accounts for the change in the reassembler
+	// memory totals, where fast_buf counts like the generic
+	// reassembler's blocks.
+	void SetFastCap(uint64_t cap);
+
+	// Checks a fragment arriving after reassembly has completed for
+	// overlaps with the reassembled datagram.
+	void CheckLateFragment(uint64_t offset, uint32_t len, const u_char* data);
+
+	// Takes ownership of pkt_start, a complete datagram of n bytes
+	// including the unfragmentable headers, and sets reassembled_pkt.
+	void Reassembled(u_char* pkt_start, uint64_t n);
+
 	u_char* proto_hdr;
 	IP_Hdr* reassembled_pkt;
+	uint64_t reassembled_len;	// payload bytes in reassembled_pkt
 	uint16_t proto_hdr_len;
 	NetSessions* s;
 	uint64_t frag_size;	// size of fully reassembled fragment
 	uint16_t next_proto; // first IPv6 fragment header's next proto field
 	FragReassemblerKey key;
 
+	// As long as fragments arrive in order and without overlap, they
+	// are copied straight into fast_buf, which starts with the
+	// unfragmentable headers, rather than going through the generic
+	// reassembler's blocks.
+	bool fast_path;
+	u_char* fast_buf;
+	uint64_t fast_len;	// payload bytes in fast_buf
+	uint64_t fast_cap;	// payload bytes that fit into fast_buf
+
+	std::list<FragReassembler*>::iterator age_pos;
+
 	FragTimer* expire_timer;
 };
 
@@ -778,6 +778,7 @@ void init_builtin_funcs()
 	ThreadStats = internal_type("ThreadStats")->AsRecordType();
 	BrokerStats = internal_type("BrokerStats")->AsRecordType();
 	ReporterStats = internal_type("ReporterStats")->AsRecordType();
+	AnalyzerStats = internal_type("AnalyzerStats")->AsRecordType();
 
 	var_sizes = internal_type("var_sizes")->AsTableType();
 
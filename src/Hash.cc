@@ -14,6 +14,12 @@
 // length. MD5 is used as a scrambling scheme so that it is difficult
 // for the adversary to construct conflicts, though I do not know if
 // HMAC/MD5 is provably universal.
+//
+// Setting $ZEEK_HASH_FUNCTION to "fast" replaces both with a wyhash-style
+// hash (based on the public domain wyhash by Wang Yi) for data of any
+// length.  It's seeded from the same per-process random bits as SipHash,
+// so it still prevents precomputed collisions, but it is considerably
+// cheaper, particularly for keys longer than UHASH_KEY_SIZE.
 
 #include "zeek-config.h"
 
@@ -23,11 +29,211 @@
 
 #include "siphash24.h"
 
+#include "3rdparty/doctest.h"
+
+#include <chrono>
+
+static HashFunction selected_hash_function = HASH_FUNCTION_SIPHASH;
+static uint64_t fast_hash_seed = 0;
+
+namespace {
+
+// Multiplication constants of wyhash.
+const uint64_t wyp[4] = {
+	0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+	0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+};
+
+inline uint64_t wymix(uint64_t a, uint64_t b)
+	{
+	__uint128_t r = a;
+	r *= b;
+	return uint64_t(r) ^ uint64_t(r >> 64);
+	}
+
+inline uint64_t wyr8(const uint8_t* p)
+	{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+	}
+
+inline uint64_t wyr4(const uint8_t* p)
+	{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+	}
+
+inline uint64_t wyr3(const uint8_t* p, size_t k)
+	{
+	return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+	}
+
+uint64_t fast_hash(const void* bytes, size_t len, uint64_t seed)
+	{
+	const uint8_t* p = static_cast<const uint8_t*>(bytes);
+	uint64_t a, b;
+
+	seed ^= wymix(seed ^ wyp[0], wyp[1]);
+
+	if ( len <= 16 )
+		{
+		if ( len >= 4 )
+			{
+			size_t m = (len >> 3) << 2;
+			a = (wyr4(p) << 32) | wyr4(p + m);
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - m);
+			}
+		else if ( len > 0 )
+			{
+			a = wyr3(p, len);
+			b = 0;
+			}
+		else
+			a = b = 0;
+		}
+
+	else
+		{
+		size_t i = len;
+
+		if ( i > 48 )
+			{
+			uint64_t see1 = seed;
+			uint64_t see2 = seed;
+
+			do
+				{
+				seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+				}
+			while ( i > 48 );
+
+			seed ^= see1 ^ see2;
+			}
+
+		while ( i > 16 )
+			{
+			seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+			}
+
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+		}
+
+	__uint128_t r = a ^ wyp[1];
+	r *= b ^ seed;
+	return wymix(uint64_t(r) ^ wyp[0] ^ len, uint64_t(r >> 64) ^ wyp[1]);
+	}
+
+hash_t siphash_bytes(const void* bytes, int size)
+	{
+	if ( size <= UHASH_KEY_SIZE )
+		{
+		hash_t digest;
+		siphash(&digest, (const uint8_t *)bytes, size, shared_siphash_key);
+		return digest;
+		}
+
+	// Fall back to HMAC/MD5 for longer data (which is usually rare).
+	assert(sizeof(hash_t) == 8);
+	hash_t digest[2]; // 2x hash_t (uint64_t) = 128 bits = 32 hex chars = sizeof md5
+	hmac_md5(size, (const unsigned char*) bytes, (unsigned char*) digest);
+	return digest[0];
+	}
+
+}
+
+TEST_CASE("hash fast_hash")
+	{
+	const char* data = "The quick brown fox jumps over the lazy dog, twice over.";
+	size_t n = strlen(data);
+
+	for ( size_t len = 0; len <= n; ++len )
+		{
+		CHECK(fast_hash(data, len, 1) == fast_hash(data, len, 1));
+		CHECK(fast_hash(data, len, 1) != fast_hash(data, len, 2));
+
+		if ( len > 0 )
+			CHECK(fast_hash(data, len, 1) != fast_hash(data, len - 1, 1));
+		}
+
+	// Keys differing only in a trailing zero byte must not collide.
+	uint8_t zeros[64] = { 0 };
+	CHECK(fast_hash(zeros, 16, 1) != fast_hash(zeros, 17, 1));
+	CHECK(fast_hash(zeros, 48, 1) != fast_hash(zeros, 49, 1));
+	}
+
+// Not run by default; use "zeek --test -tc='hash benchmark' --no-skip".
+TEST_CASE("hash benchmark" * doctest::skip())
+	{
+	// Typical Dictionary keys: counts/ports, addresses, conn_id-style
+	// composite keys, session keys, and short strings.
+	const int sizes[] = { 4, 8, 16, 20, 36, 40, 64, 128 };
+	const int iterations = 10000000;
+	uint8_t buf[128];
+
+	for ( size_t i = 0; i < sizeof(buf); ++i )
+		buf[i] = uint8_t(i * 7);
+
+	for ( auto size : sizes )
+		{
+		hash_t sink = 0;
+		auto t0 = std::chrono::steady_clock::now();
+
+		for ( int i = 0; i < iterations; ++i )
+			{
+			buf[0] = uint8_t(i);
+			sink ^= siphash_bytes(buf, size);
+			}
+
+		auto t1 = std::chrono::steady_clock::now();
+
+		for ( int i = 0; i < iterations; ++i )
+			{
+			buf[0] = uint8_t(i);
+			sink ^= fast_hash(buf, size, fast_hash_seed);
+			}
+
+		auto t2 = std::chrono::steady_clock::now();
+		std::chrono::duration<double, std::nano> d_sip = t1 - t0;
+		std::chrono::duration<double, std::nano> d_fast = t2 - t1;
+
+		MESSAGE(fmt("%3d bytes: siphash %.2f ns/key, fast %.2f ns/key (%" PRIx64 ")",
+		            size, d_sip.count() / iterations,
+		            d_fast.count() / iterations, sink));
+		}
+	}
+
 void init_hash_function()
 	{
 	// Make sure we have already called init_random_seed().
 	if ( ! (hmac_key_set && siphash_key_set) )
 		reporter->InternalError("Zeek's hash functions aren't fully initialized");
+
+	const char* hf = zeekenv("ZEEK_HASH_FUNCTION");
+
+	if ( hf && *hf )
+		{
+		if ( streq(hf, "siphash") )
+			selected_hash_function = HASH_FUNCTION_SIPHASH;
+		else if ( streq(hf, "fast") )
+			selected_hash_function = HASH_FUNCTION_FAST;
+		else
+			reporter->FatalError("unknown hash function '%s' in ZEEK_HASH_FUNCTION, use 'siphash' or 'fast'", hf);
+		}
+
+	// Derive the seed from the SipHash key so that it's reproducible
+	// via seed files, without exposing the key itself.
+	static const char seed_label[] = "fast hash seed";
+	siphash(&fast_hash_seed, (const uint8_t*) seed_label,
+	        sizeof(seed_label) - 1, shared_siphash_key);
 	}
 
 HashKey::HashKey(bro_int_t i)
@@ -165,16 +371,8 @@ void* HashKey::CopyKey(const void* k, int s) const
 
 hash_t HashKey::HashBytes(const void* bytes, int size)
 	{
-	if ( size <= UHASH_KEY_SIZE )
-		{
-		hash_t digest;
-		siphash(&digest, (const uint8_t *)bytes, size, shared_siphash_key);
-		return digest;
-		}
+	if ( selected_hash_function == HASH_FUNCTION_FAST )
+		return fast_hash(bytes, size, fast_hash_seed);
 
-	// Fall back to HMAC/MD5 for longer data (which is usually rare).
-	assert(sizeof(hash_t) == 8);
-	hash_t digest[2]; // 2x hash_t (uint64_t) = 128 bits = 32 hex chars = sizeof md5
-	hmac_md5(size, (const unsigned char*) bytes, (unsigned char*) digest);
-	return digest[0];
+	return siphash_bytes(bytes, size);
 	}
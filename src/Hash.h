@@ -12,6 +12,13 @@ class BroString;
 
 typedef uint64_t hash_t;
 
+// The functions that HashKey::HashBytes() can use.  Both are keyed with
+// per-process random bits, so adversaries can't precompute collisions.
+typedef enum {
+	HASH_FUNCTION_SIPHASH,	// SipHash-2-4, HMAC/MD5 for long keys (default)
+	HASH_FUNCTION_FAST,	// seeded wyhash-style hash for all key lengths
+} HashFunction;
+
 typedef enum {
 	HASH_KEY_INT,
 	HASH_KEY_DOUBLE,
@@ -86,4 +93,6 @@ protected:
 	hash_t hash;
 };
 
+// Selects the hash function via $ZEEK_HASH_FUNCTION ("siphash" or "fast")
+// and derives its key.  Must be called after init_random_seed().
 extern void init_hash_function();
@@ -176,7 +176,7 @@ public:
 	/**
 	 * Accesses the header at the given location in the chain.
 	 */
-	const IPv6_Hdr* operator[](const size_t i) const { return chain[i]; }
+	const IPv6_Hdr* operator[](const size_t i) const { return &chain[i]; }
 
 	/**
 	 * Returns whether the header chain indicates a fragmented packet.
@@ -188,7 +188,7 @@ public:
 	 */
 	const struct ip6_frag* GetFragHdr() const
 		{ return IsFragment() ?
-				(const struct ip6_frag*)chain[chain.size()-1]->Data(): 0; }
+				(const struct ip6_frag*)chain[chain.size()-1].Data(): 0; }
 
 	/**
 	 * If the header chain is a fragment, returns the offset in number of bytes
@@ -277,7 +277,9 @@ protected:
 	void ProcessDstOpts(const struct ip6_dest* d, uint16_t len);
 #endif
 
-	vector<IPv6_Hdr*> chain;
+	// Held by value; headers only point into the packet data, so this
+	// keeps decoding a chain down to a single allocation.
+	vector<IPv6_Hdr> chain;
 
 	/**
 	 * The summation of all header lengths in the chain in bytes.
@@ -311,7 +313,7 @@ public:
 	 * @param arg_del whether to take ownership of \a arg_ip4 pointer's memory.
 	 */
 	IP_Hdr(const struct ip* arg_ip4, bool arg_del)
-		: ip4(arg_ip4), ip6(0), del(arg_del), ip6_hdrs(0)
+		: ip4(arg_ip4), ip6(0), del(arg_del), del_chain(true), ip6_hdrs(0)
 		{
 		}
 
@@ -324,11 +326,14 @@ public:
 	 * @param arg_ip6 pointer to memory containing an IPv6 packet.
 	 * @param arg_del whether to take ownership of \a arg_ip6 pointer's memory.
 	 * @param len the packet's length in bytes.
-	 * @param c an already-constructed header chain to take ownership of.
+	 * @param c an already-constructed header chain to use.
+	 * @param arg_del_chain whether to take ownership of \a c.  Passing
+	 * false allows callers to keep the chain on the stack.
 	 */
 	IP_Hdr(const struct ip6_hdr* arg_ip6, bool arg_del, int len,
-	       const IPv6_Hdr_Chain* c = 0)
+	       const IPv6_Hdr_Chain* c = 0, bool arg_del_chain = true)
 		: ip4(0), ip6(arg_ip6), del(arg_del),
+		  del_chain(c ? arg_del_chain : true),
 		  ip6_hdrs(c ? c : new IPv6_Hdr_Chain(ip6, len))
 		{
 		}
@@ -345,7 +350,8 @@ public:
 	 */
 	~IP_Hdr()
 		{
-		delete ip6_hdrs;
+		if ( del_chain )
+			delete ip6_hdrs;
 
 		if ( del )
 			{
@@ -546,5 +552,6 @@ private:
 	const struct ip* ip4;
 	const struct ip6_hdr* ip6;
 	bool del;
+	bool del_chain;
 	const IPv6_Hdr_Chain* ip6_hdrs;
 };
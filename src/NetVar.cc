@@ -41,6 +41,9 @@ int tcp_match_undelivered;
 int encap_hdr_size;
 
 double frag_timeout;
+int max_frag_reassemblers;
+
+int analyzer_accounting;
 
 double tcp_SYN_timeout;
 double tcp_session_timer;
@@ -167,9 +170,12 @@ int dpd_reassemble_first_packets;
 int dpd_buffer_size;
 int dpd_match_only_beginning;
 int dpd_late_match_stop;
+int dpd_match_first_bytes;
 int dpd_ignore_ports;
 
 TableVal* likely_server_ports;
+TableVal* flow_meter_nets;
+TableVal* flow_meter_ports;
 
 int check_for_unused_event_handlers;
 
@@ -274,6 +280,9 @@ void init_net_var()
 	encap_hdr_size = opt_internal_int("encap_hdr_size");
 
 	frag_timeout = opt_internal_double("frag_timeout");
+	max_frag_reassemblers = opt_internal_int("max_frag_reassemblers");
+
+	analyzer_accounting = opt_internal_int("analyzer_accounting");
 
 	tcp_SYN_timeout = opt_internal_double("tcp_SYN_timeout");
 	tcp_session_timer = opt_internal_double("tcp_session_timer");
@@ -412,9 +421,12 @@ void init_net_var()
 	dpd_buffer_size = opt_internal_int("dpd_buffer_size");
 	dpd_match_only_beginning = opt_internal_int("dpd_match_only_beginning");
 	dpd_late_match_stop = opt_internal_int("dpd_late_match_stop");
+	dpd_match_first_bytes = opt_internal_int("dpd_match_first_bytes");
 	dpd_ignore_ports = opt_internal_int("dpd_ignore_ports");
 
 	likely_server_ports = internal_val("likely_server_ports")->AsTableVal();
+	flow_meter_nets = internal_val("flow_meter_nets")->AsTableVal();
+	flow_meter_ports = internal_val("flow_meter_ports")->AsTableVal();
 
 	timer_mgr_inactivity_timeout =
 		opt_internal_double("timer_mgr_inactivity_timeout");
@@ -41,6 +41,9 @@ extern int tcp_match_undelivered;
 extern int encap_hdr_size;
 
 extern double frag_timeout;
+extern int max_frag_reassemblers;
+
+extern int analyzer_accounting;
 
 extern double tcp_SYN_timeout;
 extern double tcp_session_timer;
@@ -166,9 +169,12 @@ extern int dpd_reassemble_first_packets;
 extern int dpd_buffer_size;
 extern int dpd_match_only_beginning;
 extern int dpd_late_match_stop;
+extern int dpd_match_first_bytes;
 extern int dpd_ignore_ports;
 
 extern TableVal* likely_server_ports;
+extern TableVal* flow_meter_nets;
+extern TableVal* flow_meter_ports;
 
 extern int check_for_unused_event_handlers;
 
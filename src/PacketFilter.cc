@@ -1,96 +1,257 @@
 #include "PacketFilter.h"
 #include "IP.h"
+#include "Val.h"
 
-void PacketFilter::DeleteFilter(void* data)
+// Returns the address and prefix width of an AddrVal or SubnetVal.
+static void prefix_from_val(const Val* v, IPAddr* addr, int* width)
 	{
-	auto f = static_cast<Filter*>(data);
-	delete f;
+	if ( v->Type()->Tag() == TYPE_SUBNET )
+		{
+		*addr = v->AsSubNet().Prefix();
+		*width = v->AsSubNet().LengthIPv6();
+		}
+	else
+		{
+		*addr = v->AsAddr();
+		*width = 128;
+		}
+	}
+
+static uint32_t port_key(Val* port)
+	{
+	PortVal* p = port->AsPortVal();
+	return PortVal::Mask(p->Port(), p->PortType());
+	}
+
+void PacketFilter::DeleteRules(void* data)
+	{
+	auto r = static_cast<Rules*>(data);
+	delete r;
 	}
 
 PacketFilter::PacketFilter(bool arg_default)
 	{
 	default_match = arg_default;
-	src_filter.SetDeleteFunction(PacketFilter::DeleteFilter);
-	dst_filter.SetDeleteFunction(PacketFilter::DeleteFilter);
+	src_filter.SetDeleteFunction(PacketFilter::DeleteRules);
+	dst_filter.SetDeleteFunction(PacketFilter::DeleteRules);
 	}
 
 void PacketFilter::AddSrc(const IPAddr& src, uint32_t tcp_flags, double probability)
 	{
-	Filter* f = new Filter;
-	f->tcp_flags = tcp_flags;
-	f->probability = uint32_t(probability * RAND_MAX);
-	auto prev = static_cast<Filter*>(src_filter.Insert(src, 128, f));
-	delete prev;
+	AddRule(src_filter, src, 128, nullptr, tcp_flags, probability);
 	}
 
-void PacketFilter::AddSrc(Val* src, uint32_t tcp_flags, double probability)
+void PacketFilter::AddSrc(Val* src, uint32_t tcp_flags, double probability,
+                          Val* port)
 	{
-	Filter* f = new Filter;
-	f->tcp_flags = tcp_flags;
-	f->probability = uint32_t(probability * RAND_MAX);
-	auto prev = static_cast<Filter*>(src_filter.Insert(src, f));
-	delete prev;
+	IPAddr addr;
+	int width;
+	prefix_from_val(src, &addr, &width);
+	AddRule(src_filter, addr, width, port, tcp_flags, probability);
 	}
 
 void PacketFilter::AddDst(const IPAddr& dst, uint32_t tcp_flags, double probability)
 	{
-	Filter* f = new Filter;
-	f->tcp_flags = tcp_flags;
-	f->probability = uint32_t(probability * RAND_MAX);
-	auto prev = static_cast<Filter*>(dst_filter.Insert(dst, 128, f));
-	delete prev;
+	AddRule(dst_filter, dst, 128, nullptr, tcp_flags, probability);
+	}
+
+void PacketFilter::AddDst(Val* dst, uint32_t tcp_flags, double probability,
+                          Val* port)
+	{
+	IPAddr addr;
+	int width;
+	prefix_from_val(dst, &addr, &width);
+	AddRule(dst_filter, addr, width, port, tcp_flags, probability);
+	}
+
+void PacketFilter::AddPort(Val* port, uint32_t tcp_flags, double probability)
+	{
+	Filter& f = port_filter.ports[port_key(port)];
+	f.tcp_flags = tcp_flags;
+	f.probability = uint32_t(probability * RAND_MAX);
 	}
 
-void PacketFilter::AddDst(Val* dst, uint32_t tcp_flags, double probability)
+void PacketFilter::AddRule(PrefixTable& t, const IPAddr& addr, int width,
+                           Val* port, uint32_t tcp_flags, double probability)
 	{
-	Filter* f = new Filter;
+	auto r = static_cast<Rules*>(t.Lookup(addr, width, true));
+
+	if ( ! r )
+		{
+		r = new Rules;
+		t.Insert(addr, width, r);
+		}
+
+	Filter* f;
+
+	if ( port )
+		f = &r->ports[port_key(port)];
+	else
+		{
+		r->any_port = true;
+		f = &r->any;
+		}
+
 	f->tcp_flags = tcp_flags;
 	f->probability = uint32_t(probability * RAND_MAX);
-	auto prev = static_cast<Filter*>(dst_filter.Insert(dst, f));
-	delete prev;
 	}
 
 bool PacketFilter::RemoveSrc(const IPAddr& src)
 	{
-	auto f = static_cast<Filter*>(src_filter.Remove(src, 128));
-	delete f;
-	return f != nullptr;
+	return RemoveRule(src_filter, src, 128, nullptr);
 	}
 
-bool PacketFilter::RemoveSrc(Val* src)
+bool PacketFilter::RemoveSrc(Val* src, Val* port)
 	{
-	auto f = static_cast<Filter*>(src_filter.Remove(src));
-	delete f;
-	return f != nullptr;
+	IPAddr addr;
+	int width;
+	prefix_from_val(src, &addr, &width);
+	return RemoveRule(src_filter, addr, width, port);
 	}
 
 bool PacketFilter::RemoveDst(const IPAddr& dst)
 	{
-	auto f = static_cast<Filter*>(dst_filter.Remove(dst, 128));
-	delete f;
-	return f != nullptr;
+	return RemoveRule(dst_filter, dst, 128, nullptr);
 	}
 
-bool PacketFilter::RemoveDst(Val* dst)
+bool PacketFilter::RemoveDst(Val* dst, Val* port)
 	{
-	auto f = static_cast<Filter*>(dst_filter.Remove(dst));
-	delete f;
-	return f != nullptr;
+	IPAddr addr;
+	int width;
+	prefix_from_val(dst, &addr, &width);
+	return RemoveRule(dst_filter, addr, width, port);
+	}
+
+bool PacketFilter::RemovePort(Val* port)
+	{
+	return port_filter.ports.erase(port_key(port)) > 0;
+	}
+
+bool PacketFilter::RemoveRule(PrefixTable& t, const IPAddr& addr, int width,
+                              Val* port)
+	{
+	auto r = static_cast<Rules*>(t.Lookup(addr, width, true));
+
+	if ( ! r )
+		return false;
+
+	if ( port )
+		{
+		if ( r->ports.erase(port_key(port)) == 0 )
+			return false;
+		}
+
+	else
+		{
+		if ( ! r->any_port )
+			return false;
+
+		r->any_port = false;
+		}
+
+	if ( ! r->any_port && r->ports.empty() )
+		{
+		t.Remove(addr, width);
+		delete r;
+		}
+
+	return true;
 	}
 
 bool PacketFilter::Match(const IP_Hdr* ip, int len, int caplen)
 	{
-	Filter* f = (Filter*) src_filter.Lookup(ip->SrcAddr(), 128);
-	if ( f )
-		return MatchFilter(*f, *ip, len, caplen);
+	// The destination and source port, masked like the keys of
+	// Rules::ports, for TCP and UDP packets that carry them.
+	uint32_t ports[2];
+	const uint32_t* pp = nullptr;
+	uint32_t mask = 0;
+
+	switch ( ip->NextProto() ) {
+	case IPPROTO_TCP:
+		mask = TCP_PORT_MASK;
+		break;
+
+	case IPPROTO_UDP:
+		mask = UDP_PORT_MASK;
+		break;
+	}
+
+	// Later fragments don't carry the ports.  Both TCP and UDP start
+	// with the source and destination ports.
+	if ( mask && ! (ip->IsFragment() && ip->FragOffset() != 0) &&
+	     caplen >= ip->HdrLen() + 4 )
+		{
+		const u_char* p = ip->Payload();
+		ports[0] = ((p[2] << 8) | p[3]) | mask;
+		ports[1] = ((p[0] << 8) | p[1]) | mask;
+		pp = ports;
+		}
+
+	const Filter* f = LookupPrefix(src_filter, ip->SrcAddr(), pp);
+
+	if ( ! f )
+		f = LookupPrefix(dst_filter, ip->DstAddr(), pp);
+
+	if ( ! f )
+		f = FindRule(port_filter, pp);
 
-	f = (Filter*) dst_filter.Lookup(ip->DstAddr(), 128);
 	if ( f )
 		return MatchFilter(*f, *ip, len, caplen);
 
 	return default_match;
 	}
 
+const PacketFilter::Filter* PacketFilter::FindRule(const Rules& r,
+                                                   const uint32_t* ports)
+	{
+	if ( ports && ! r.ports.empty() )
+		{
+		auto it = r.ports.find(ports[0]);
+		if ( it != r.ports.end() )
+			return &it->second;
+
+		it = r.ports.find(ports[1]);
+		if ( it != r.ports.end() )
+			return &it->second;
+		}
+
+	return r.any_port ? &r.any : nullptr;
+	}
+
+const PacketFilter::Filter* PacketFilter::LookupPrefix(const PrefixTable& t,
+                                                       const IPAddr& addr,
+                                                       const uint32_t* ports) const
+	{
+	auto r = static_cast<const Rules*>(t.Lookup(addr, 128));
+
+	if ( ! r )
+		return nullptr;
+
+	const Filter* f = FindRule(*r, ports);
+
+	if ( f || r->any_port )
+		return f;
+
+	// The longest matching prefix only has rules for other ports,
+	// a shorter one may still apply.
+	int best_len = -1;
+
+	for ( const auto& m : t.FindAll(addr, 128) )
+		{
+		const IPPrefix& prefix = std::get<0>(m);
+		auto mr = static_cast<const Rules*>(std::get<1>(m));
+		const Filter* mf = FindRule(*mr, ports);
+
+		if ( mf && prefix.LengthIPv6() > best_len )
+			{
+			f = mf;
+			best_len = prefix.LengthIPv6();
+			}
+		}
+
+	return f;
+	}
+
 bool PacketFilter::MatchFilter(const Filter& f, const IP_Hdr& ip,
 				int len, int caplen)
 	{
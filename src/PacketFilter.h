@@ -5,6 +5,8 @@
 #include "IPAddr.h"
 #include "PrefixTable.h"
 
+#include <map>
+
 class IP_Hdr;
 class Val;
 
@@ -15,20 +17,33 @@ public:
 
 	// Drops all packets from a particular source (which may be given
 	// as an AddrVal or a SubnetVal) which hasn't any of TCP flags set
-	// (TH_*) with the given probability (from 0..MAX_PROB).
+	// (TH_*) with the given probability (from 0..MAX_PROB).  If a port
+	// (a TCP or UDP PortVal) is given, the rule only applies to TCP or
+	// UDP packets to or from that port.
 	void AddSrc(const IPAddr& src, uint32_t tcp_flags, double probability);
-	void AddSrc(Val* src, uint32_t tcp_flags, double probability);
+	void AddSrc(Val* src, uint32_t tcp_flags, double probability,
+	            Val* port = nullptr);
 	void AddDst(const IPAddr& src, uint32_t tcp_flags, double probability);
-	void AddDst(Val* src, uint32_t tcp_flags, double probability);
+	void AddDst(Val* src, uint32_t tcp_flags, double probability,
+	            Val* port = nullptr);
+
+	// Drops all TCP or UDP packets to or from a particular port (given
+	// as a PortVal) regardless of their addresses.
+	void AddPort(Val* port, uint32_t tcp_flags, double probability);
 
-	// Removes the filter entry for the given src/dst
+	// Removes the filter entry for the given src/dst (and port, if any).
 	// Returns false if filter doesn not exist.
 	bool RemoveSrc(const IPAddr& src);
-	bool RemoveSrc(Val* dst);
+	bool RemoveSrc(Val* dst, Val* port = nullptr);
 	bool RemoveDst(const IPAddr& dst);
-	bool RemoveDst(Val* dst);
+	bool RemoveDst(Val* dst, Val* port = nullptr);
+	bool RemovePort(Val* port);
 
-	// Returns true if packet matches a drop filter
+	// Returns true if packet matches a drop filter.  If several rules
+	// apply, source rules take precedence over destination rules, which
+	// take precedence over rules for just a port.  Among the source
+	// (destination) rules, the one for the longest prefix wins, and for
+	// the same prefix one for the packet's port wins over one for any.
 	bool Match(const IP_Hdr* ip, int len, int caplen);
 
 private:
@@ -37,11 +52,32 @@ private:
 		uint32_t probability;
 	};
 
-	static void DeleteFilter(void* data);
+	// All rules for one prefix, or the ones without a prefix: at most
+	// one for any port, plus the ones for particular ports, indexed by
+	// PortVal::Mask()'ed port numbers.
+	struct Rules {
+		bool any_port = false;
+		Filter any;
+		std::map<uint32_t, Filter> ports;
+	};
+
+	static void DeleteRules(void* data);
+
+	void AddRule(PrefixTable& t, const IPAddr& addr, int width, Val* port,
+	             uint32_t tcp_flags, double probability);
+	bool RemoveRule(PrefixTable& t, const IPAddr& addr, int width, Val* port);
+
+	// Returns the rule applying to a packet with the given ports, if
+	// any.  ports holds the masked destination and source ports, or is
+	// nil if the packet doesn't have any.
+	static const Filter* FindRule(const Rules& r, const uint32_t* ports);
+	const Filter* LookupPrefix(const PrefixTable& t, const IPAddr& addr,
+	                           const uint32_t* ports) const;
 
 	bool MatchFilter(const Filter& f, const IP_Hdr& ip, int len, int caplen);
 
 	bool default_match;
 	PrefixTable src_filter;
 	PrefixTable dst_filter;
+	Rules port_filter;
 };
@@ -2,6 +2,8 @@
 #include "Reporter.h"
 #include "Val.h"
 
+#include <algorithm>
+
 prefix_t* PrefixTable::MakePrefix(const IPAddr& addr, int width)
 	{
 	prefix_t* prefix = (prefix_t*) safe_malloc(sizeof(prefix_t));
@@ -21,6 +23,8 @@ IPPrefix PrefixTable::PrefixToIPPrefix(prefix_t* prefix)
 
 void* PrefixTable::Insert(const IPAddr& addr, int width, void* data)
 	{
+	Invalidate();
+
 	prefix_t* prefix = MakePrefix(addr, width);
 	patricia_node_t* node = patricia_lookup(tree, prefix);
 	Deref_Prefix(prefix);
@@ -88,14 +92,24 @@ list<tuple<IPPrefix,void*>> PrefixTable::FindAll(const SubNetVal* value) const
 
 void* PrefixTable::Lookup(const IPAddr& addr, int width, bool exact) const
 	{
+	if ( ! exact && width == 128 && addr.GetFamily() == IPv4 )
+		{
+		if ( v4_compiled )
+			return LookupIPv4(addr);
+
+		if ( tree->num_active_node >= MIN_COMPILED_PREFIXES &&
+		     ++lookups_since_change >= tree->num_active_node )
+			{
+			CompileIPv4();
+			return LookupIPv4(addr);
+			}
+		}
+
 	prefix_t* prefix = MakePrefix(addr, width);
 	patricia_node_t* node =
 		exact ? patricia_search_exact(tree, prefix) :
 			patricia_search_best(tree, prefix);
 
-	int elems = 0;
-	patricia_node_t** list = nullptr;
-
 	Deref_Prefix(prefix);
 	return node ? node->data : 0;
 	}
@@ -133,6 +147,8 @@ void* PrefixTable::Remove(const IPAddr& addr, int width)
 	if ( ! node )
 		return 0;
 
+	Invalidate();
+
 	void* old = node->data;
 	patricia_remove(tree, node);
 
@@ -202,3 +218,128 @@ void* PrefixTable::GetNext(iterator* i)
 
 	// Not reached.
 	}
+
+void* PrefixTable::LookupIPv4(const IPAddr& addr) const
+	{
+	in4_addr in4;
+	addr.CopyIPv4(&in4);
+	uint32_t a = ntohl(in4.s_addr);
+
+	// v4_starts[0] is always 0, so there's a range containing a.
+	auto it = std::upper_bound(v4_starts.begin(), v4_starts.end(), a);
+	return v4_data[(it - v4_starts.begin()) - 1];
+	}
+
+void PrefixTable::CompileIPv4() const
+	{
+	struct Range {
+		uint32_t start;
+		uint32_t end; // inclusive
+		void* data;
+	};
+
+	std::vector<Range> ranges;
+
+	// Collect all IPv4 prefixes other than 0.0.0.0/0.
+	patricia_node_t* stack[PATRICIA_MAXBITS+1];
+	patricia_node_t** sp = stack;
+	patricia_node_t* rn = tree->head;
+
+	while ( rn )
+		{
+		if ( rn->prefix && rn->prefix->bitlen > 96 )
+			{
+			IPAddr a(IPv6, reinterpret_cast<const uint32_t*>(&rn->prefix->add.sin6), IPAddr::Network);
+
+			if ( a.GetFamily() == IPv4 )
+				{
+				in4_addr in4;
+				a.CopyIPv4(&in4);
+				int len = rn->prefix->bitlen - 96;
+				uint32_t mask = len == 32 ? 0 : (0xffffffffu >> len);
+				uint32_t start = ntohl(in4.s_addr) & ~mask;
+				ranges.push_back({start, start | mask, rn->data});
+				}
+			}
+
+		if ( rn->l )
+			{
+			if ( rn->r )
+				*sp++ = rn->r;
+
+			rn = rn->l;
+			}
+
+		else if ( rn->r )
+			rn = rn->r;
+
+		else if ( sp != stack )
+			rn = *(--sp);
+
+		else
+			rn = 0;
+		}
+
+	// Anything not covered by an IPv4 prefix falls back to the best
+	// match for the whole IPv4-mapped space, e.g., ::/0.
+	prefix_t* v4_space = MakePrefix(IPAddr("0.0.0.0"), 96);
+	patricia_node_t* best = patricia_search_best(tree, v4_space);
+	Deref_Prefix(v4_space);
+
+	Range all = {0, 0xffffffffu, best ? best->data : 0};
+
+	// Prefixes either nest or are disjoint, so sorting by start and then
+	// by decreasing size puts each one right after those containing it.
+	std::sort(ranges.begin(), ranges.end(),
+	          [](const Range& x, const Range& y)
+			{
+			return x.start < y.start ||
+			       (x.start == y.start && x.end > y.end);
+			});
+
+	v4_starts.clear();
+	v4_data.clear();
+
+	auto emit = [this](uint32_t start, void* data)
+		{
+		if ( ! v4_starts.empty() && v4_starts.back() == start )
+			{
+			v4_starts.pop_back();
+			v4_data.pop_back();
+			}
+
+		if ( ! v4_data.empty() && v4_data.back() == data )
+			return;
+
+		v4_starts.push_back(start);
+		v4_data.push_back(data);
+		};
+
+	std::vector<const Range*> open;
+	open.push_back(&all);
+	emit(0, all.data);
+
+	for ( const auto& r : ranges )
+		{
+		while ( open.back()->end < r.start )
+			{
+			uint32_t next = open.back()->end + 1;
+			open.pop_back();
+			emit(next, open.back()->data);
+			}
+
+		emit(r.start, r.data);
+		open.push_back(&r);
+		}
+
+	while ( open.size() > 1 )
+		{
+		uint32_t end = open.back()->end;
+		open.pop_back();
+
+		if ( end != 0xffffffffu )
+			emit(end + 1, open.back()->data);
+		}
+
+	v4_compiled = true;
+	}
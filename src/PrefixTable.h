@@ -7,6 +7,7 @@ extern "C" {
 }
 
 #include <list>
+#include <vector>
 
 using std::list;
 using std::tuple;
@@ -27,6 +28,9 @@ public:
 	PrefixTable()	{ tree = New_Patricia(128); delete_function = nullptr; }
 	~PrefixTable()	{ Destroy_Patricia(tree, delete_function); }
 
+	// Tables with fewer prefixes than this always use the trie.
+	static const int MIN_COMPILED_PREFIXES = 64;
+
 	// Addr in network byte order. If data is zero, acts like a set.
 	// Returns ptr to old data if already existing.
 	// For existing items without data, returns non-nil if found.
@@ -49,7 +53,7 @@ public:
 	void* Remove(const IPAddr& addr, int width);
 	void* Remove(const Val* value);
 
-	void Clear()	{ Clear_Patricia(tree, delete_function); }
+	void Clear()	{ Clear_Patricia(tree, delete_function); Invalidate(); }
 
 	// Sets a function to call for each node when table is cleared/destroyed.
 	void SetDeleteFunction(data_fn_t del_fn)	{ delete_function = del_fn; }
@@ -61,6 +65,27 @@ private:
 	static prefix_t* MakePrefix(const IPAddr& addr, int width);
 	static IPPrefix PrefixToIPPrefix(prefix_t* p);
 
+	// Longest-prefix match for IPv4 addresses is answered from a
+	// sorted array of disjoint address ranges, each carrying the data
+	// of the longest prefix covering it. It's built lazily once enough
+	// lookups have happened since the last change to pay for it, and
+	// discarded whenever the table is modified.
+	void Invalidate()
+		{
+		v4_compiled = false;
+		lookups_since_change = 0;
+		v4_starts.clear();
+		v4_data.clear();
+		}
+
+	void CompileIPv4() const;
+	void* LookupIPv4(const IPAddr& addr) const;
+
 	patricia_tree_t* tree;
 	data_fn_t delete_function;
+
+	mutable bool v4_compiled = false;
+	mutable int lookups_since_change = 0;
+	mutable std::vector<uint32_t> v4_starts;
+	mutable std::vector<void*> v4_data;
 };
@@ -214,6 +214,9 @@ RuleMatcher::RuleMatcher(int arg_RE_level)
 	RE_level = arg_RE_level;
 	parse_error = false;
 	has_non_file_magic_rule = false;
+
+	for ( int i = 0; i < Rule::TYPES; ++i )
+		has_pattern_type[i] = false;
 	}
 
 RuleMatcher::~RuleMatcher()
@@ -296,6 +299,9 @@ void RuleMatcher::BuildRulesTree()
 
 		const auto& pats = rule->patterns;
 
+		for ( const auto& p : pats )
+			has_pattern_type[p->type] = true;
+
 		if ( ! has_non_file_magic_rule )
 			{
 			if ( pats.length() > 0 )
@@ -293,6 +293,10 @@ public:
 
 	bool HasNonFileMagicRule() const	{ return has_non_file_magic_rule; }
 
+	// True if any active rule has a pattern of the given type.
+	bool HasPatternType(Rule::PatternType type) const
+		{ return has_pattern_type[type]; }
+
 	// Interface to for getting some statistics
 	struct Stats {
 		unsigned int matchers;	// # distinct RE matchers
@@ -364,6 +368,7 @@ private:
 
 	int RE_level;
 	bool has_non_file_magic_rule;
+	bool has_pattern_type[Rule::TYPES];
 	bool parse_error;
 	RuleHdrTest* root;
 	rule_list rules;
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "Desc.h"
 #include "Net.h"
 #include "Event.h"
@@ -79,6 +81,8 @@ NetSessions::NetSessions()
 
 	packet_filter = 0;
 
+	shunt_purge_size = 1024;
+
 	dump_this_packet = 0;
 	num_packets_processed = 0;
 
@@ -164,7 +168,11 @@ void NetSessions::NextPacket(double t, const Packet* pkt)
 			return;
 			}
 
-		IP_Hdr ip_hdr((const struct ip6_hdr*) (pkt->data + pkt->hdr_size), false, caplen);
+		// Keep the extension header chain on the stack along with the
+		// header itself, so decoding doesn't need to allocate them.
+		const struct ip6_hdr* ip6 = (const struct ip6_hdr*) (pkt->data + pkt->hdr_size);
+		IPv6_Hdr_Chain chain(ip6, caplen);
+		IP_Hdr ip_hdr(ip6, false, caplen, &chain, false);
 		DoNextPacket(t, pkt, &ip_hdr, 0);
 		}
 
@@ -264,6 +272,12 @@ void NetSessions::DoNextPacket(double t, const Packet* pkt, const IP_Hdr* ip_hdr
 			}
 		}
 
+	// Fragments get checked once reassembled, their ports may not be
+	// available until then.
+	if ( (! tcp_shunts.empty() || ! udp_shunts.empty()) &&
+	     ! ip_hdr->IsFragment() && IsShunted(t, ip_hdr, caplen) )
+		return;
+
 	// Ignore if packet matches packet filter.
 	if ( packet_filter && packet_filter->Match(ip_hdr, len, caplen) )
 		 return;
@@ -302,22 +316,36 @@ void NetSessions::DoNextPacket(double t, const Packet* pkt, const IP_Hdr* ip_hdr
 				// It didn't reassemble into anything yet.
 				return;
 
+			// Whatever vouched for the checksum of this last
+			// fragment didn't see the datagram as a whole, so
+			// the transport layer needs to check that itself.
+			if ( pkt->l4_checksummed )
+				const_cast<Packet*>(pkt)->l4_checksummed = false;
+
 			ip4 = ih->IP4_Hdr();
 			ip_hdr = ih;
 
 			caplen = len = ip_hdr->TotalLen();
 			ip_hdr_len = ip_hdr->HdrLen();
-
-			if ( ip_hdr_len > len )
-				{
-				Weird("invalid_IP_header_size", ip_hdr, encapsulation);
-				return;
-				}
 			}
 		}
 
+	// Removes the reassembler once we're done with its datagram.
 	FragReassemblerTracker frt(this, f);
 
+	if ( f )
+		{
+		if ( ip_hdr_len > len )
+			{
+			Weird("invalid_IP_header_size", ip_hdr, encapsulation);
+			return;
+			}
+
+		if ( (! tcp_shunts.empty() || ! udp_shunts.empty()) &&
+		     IsShunted(t, ip_hdr, caplen) )
+			return;
+		}
+
 	len -= ip_hdr_len;	// remove IP header
 	caplen -= ip_hdr_len;
 
@@ -878,22 +906,44 @@ FragReassembler* NetSessions::NextFragment(double t, const IP_Hdr* ip,
 
 	if ( ! f )
 		{
+		if ( max_frag_reassemblers > 0 &&
+		     fragments_by_age.size() >= size_t(max_frag_reassemblers) )
+			{
+			FragReassembler* oldest = fragments_by_age.front();
+			Weird("fragment_reassembly_evicted", ip);
+			oldest->DeleteTimer();
+			Remove(oldest);
+			}
+
 		f = new FragReassembler(this, ip, pkt, key, t);
 		fragments[key] = f;
+		f->SetAgePos(fragments_by_age.insert(fragments_by_age.end(), f));
 		if ( fragments.size() > stats.max_fragments )
 			stats.max_fragments = fragments.size();
-		return f;
+		}
+	else
+		f->AddFragment(t, ip, pkt);
+
+	// Only pending reassemblies are subject to eviction.  A complete
+	// one is removed once its datagram has been processed, which may
+	// involve reassembling tunneled fragments in turn.
+	if ( f->ReassembledPkt() && f->AgePos() != fragments_by_age.end() )
+		{
+		fragments_by_age.erase(f->AgePos());
+		f->SetAgePos(fragments_by_age.end());
 		}
 
-	f->AddFragment(t, ip, pkt);
 	return f;
 	}
 
-Connection* NetSessions::FindConnection(Val* v)
+// Fills in id from a conn_id record, or any record with equivalent
+// fields. Returns the transport protocol, or TRANSPORT_UNKNOWN if the
+// record is ill-formed.
+static TransportProto conn_id_from_val(Val* v, ConnID* id)
 	{
 	BroType* vt = v->Type();
 	if ( ! IsRecord(vt->Tag()) )
-		return 0;
+		return TRANSPORT_UNKNOWN;
 
 	RecordType* vr = vt->AsRecordType();
 	const val_list* vl = v->AsRecord();
@@ -918,7 +968,7 @@ Connection* NetSessions::FindConnection(Val* v)
 		resp_p = vr->FieldOffset("resp_p");
 
 		if ( orig_h < 0 || resp_h < 0 || orig_p < 0 || resp_p < 0 )
-			return 0;
+			return TRANSPORT_UNKNOWN;
 
 		// ### we ought to check that the fields have the right
 		// types, too.
@@ -930,24 +980,28 @@ Connection* NetSessions::FindConnection(Val* v)
 	PortVal* orig_portv = (*vl)[orig_p]->AsPortVal();
 	PortVal* resp_portv = (*vl)[resp_p]->AsPortVal();
 
-	ConnID id;
+	id->src_addr = orig_addr;
+	id->dst_addr = resp_addr;
 
-	id.src_addr = orig_addr;
-	id.dst_addr = resp_addr;
+	id->src_port = htons((unsigned short) orig_portv->Port());
+	id->dst_port = htons((unsigned short) resp_portv->Port());
 
-	id.src_port = htons((unsigned short) orig_portv->Port());
-	id.dst_port = htons((unsigned short) resp_portv->Port());
+	id->is_one_way = 0;	// ### incorrect for ICMP connections
 
-	id.is_one_way = 0;	// ### incorrect for ICMP connections
+	return orig_portv->PortType();
+	}
 
-	ConnIDKey key = BuildConnIDKey(id);
+Connection* NetSessions::FindConnection(Val* v)
+	{
+	ConnID id;
+	TransportProto proto = conn_id_from_val(v, &id);
 	ConnectionMap* d;
 
-	if ( orig_portv->IsTCP() )
+	if ( proto == TRANSPORT_TCP )
 		d = &tcp_conns;
-	else if ( orig_portv->IsUDP() )
+	else if ( proto == TRANSPORT_UDP )
 		d = &udp_conns;
-	else if ( orig_portv->IsICMP() )
+	else if ( proto == TRANSPORT_ICMP )
 		d = &icmp_conns;
 	else
 		{
@@ -957,6 +1011,7 @@ Connection* NetSessions::FindConnection(Val* v)
 		return 0;
 		}
 
+	ConnIDKey key = BuildConnIDKey(id);
 	Connection* conn = nullptr;
 	auto it = d->find(key);
 	if ( it != d->end() )
@@ -965,6 +1020,123 @@ Connection* NetSessions::FindConnection(Val* v)
 	return conn;
 	}
 
+NetSessions::ShuntMap* NetSessions::ShuntKey(Val* cid, ConnIDKey* key)
+	{
+	ConnID id;
+	TransportProto proto = conn_id_from_val(cid, &id);
+
+	ShuntMap* m;
+
+	if ( proto == TRANSPORT_TCP )
+		m = &tcp_shunts;
+	else if ( proto == TRANSPORT_UDP )
+		m = &udp_shunts;
+	else
+		return 0;
+
+	*key = BuildConnIDKey(id);
+	return m;
+	}
+
+bool NetSessions::Shunt(Val* cid, double timeout)
+	{
+	ConnIDKey key;
+	ShuntMap* m = ShuntKey(cid, &key);
+
+	if ( ! m )
+		return false;
+
+	ShuntEntry& e = (*m)[key];
+	e.timeout = timeout > 0 ? timeout : 0;
+	e.expire = timeout > 0 ? network_time + timeout : 0;
+
+	// Flows that stopped sending packets are only noticed here.
+	if ( tcp_shunts.size() + udp_shunts.size() > shunt_purge_size )
+		{
+		ExpireShunts(network_time);
+		shunt_purge_size = std::max(size_t(1024),
+		                            2 * (tcp_shunts.size() + udp_shunts.size()));
+		}
+
+	return true;
+	}
+
+bool NetSessions::Unshunt(Val* cid)
+	{
+	ConnIDKey key;
+	ShuntMap* m = ShuntKey(cid, &key);
+
+	return m && m->erase(key) > 0;
+	}
+
+void NetSessions::ExpireShunts(double t)
+	{
+	for ( auto m : { &tcp_shunts, &udp_shunts } )
+		{
+		for ( auto it = m->begin(); it != m->end(); )
+			{
+			if ( it->second.expire && t > it->second.expire )
+				it = m->erase(it);
+			else
+				++it;
+			}
+		}
+	}
+
+bool NetSessions::IsShunted(double t, const IP_Hdr* ip_hdr, uint32_t caplen)
+	{
+	ShuntMap* m;
+
+	switch ( ip_hdr->NextProto() ) {
+	case IPPROTO_TCP:
+		m = &tcp_shunts;
+		break;
+
+	case IPPROTO_UDP:
+		m = &udp_shunts;
+		break;
+
+	default:
+		return false;
+	}
+
+	if ( m->empty() )
+		return false;
+
+	// Both TCP and UDP start with the source and destination ports.
+	if ( caplen < ip_hdr->HdrLen() + 4u )
+		return false;
+
+	const u_char* ports = ip_hdr->Payload();
+
+	ConnID id;
+	id.src_addr = ip_hdr->SrcAddr();
+	id.dst_addr = ip_hdr->DstAddr();
+	memcpy(&id.src_port, ports, sizeof(id.src_port));
+	memcpy(&id.dst_port, ports + 2, sizeof(id.dst_port));
+	id.is_one_way = 0;
+
+	auto it = m->find(BuildConnIDKey(id));
+
+	if ( it == m->end() )
+		return false;
+
+	ShuntEntry& e = it->second;
+
+	if ( e.expire )
+		{
+		if ( t > e.expire )
+			{
+			m->erase(it);
+			return false;
+			}
+
+		e.expire = t + e.timeout;
+		}
+
+	return true;
+	}
+
 void NetSessions::Remove(Connection* c)
 	{
 	if ( c->IsKeyValid() )
@@ -1022,6 +1194,8 @@ void NetSessions::Remove(FragReassembler* f)
 
 	if ( fragments.erase(f->Key()) == 0 )
 		reporter->InternalWarning("fragment reassembler not in dict");
+	else if ( f->AgePos() != fragments_by_age.end() )
+		fragments_by_age.erase(f->AgePos());
 
 	Unref(f);
 	}
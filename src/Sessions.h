@@ -7,6 +7,7 @@
 #include "NetVar.h"
 #include "analyzer/protocol/tcp/Stats.h"
 
+#include <list>
 #include <map>
 #include <utility>
 
@@ -74,6 +75,16 @@ public:
 
 	void GetStats(SessionStats& s) const;
 
+	// Shunts the TCP or UDP flow referred to by the given conn_id
+	// record: its packets are dropped right after IP header decoding
+	// (or after reassembly for fragments), before checksumming,
+	// connection lookup and analysis.
+	// A timeout of zero keeps the flow shunted until Unshunt() is
+	// called, otherwise it expires that long after the last packet.
+	// Returns false if the record is ill-formed or not TCP/UDP.
+	bool Shunt(Val* cid, double timeout);
+	bool Unshunt(Val* cid);
+
 	void Weird(const char* name, const Packet* pkt,
 	    const EncapsulationStack* encap = 0, const char* addl = "");
 	void Weird(const char* name, const IP_Hdr* ip,
@@ -151,6 +162,23 @@ protected:
 	using ConnectionMap = std::map<ConnIDKey, Connection*>;
 	using FragmentMap = std::map<FragReassemblerKey, FragReassembler*>;
 
+	struct ShuntEntry {
+		double timeout;
+		double expire;	// 0 if it never expires
+	};
+
+	using ShuntMap = std::map<ConnIDKey, ShuntEntry>;
+
+	// Returns the shunt map for a conn_id record's protocol and fills
+	// in its key, or nil if the record doesn't describe a TCP/UDP flow.
+	ShuntMap* ShuntKey(Val* cid, ConnIDKey* key);
+
+	// Returns true if the packet belongs to a shunted flow.  The packet
+	// must not be a fragment.
+	bool IsShunted(double t, const IP_Hdr* ip_hdr, uint32_t caplen);
+
+	void ExpireShunts(double t);
+
 	Connection* NewConn(const ConnIDKey& k, double t, const ConnID* id,
 			const u_char* data, int proto, uint32_t flow_label,
 			const Packet* pkt, const EncapsulationStack* encapsulation);
@@ -197,6 +225,11 @@ protected:
 	ConnectionMap udp_conns;
 	ConnectionMap icmp_conns;
 	FragmentMap fragments;
+	std::list<FragReassembler*> fragments_by_age;
+
+	ShuntMap tcp_shunts;
+	ShuntMap udp_shunts;
+	size_t shunt_purge_size;
 
 	SessionStats stats;
 
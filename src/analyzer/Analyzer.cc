@@ -1,6 +1,7 @@
 // See the file "COPYING" in the main distribution directory for copyright.
 
 #include <algorithm>
+#include <chrono>
 
 #include "Analyzer.h"
 #include "Manager.h"
@@ -8,6 +9,7 @@
 
 #include "analyzer/protocol/pia/PIA.h"
 #include "../Event.h"
+#include "../NetVar.h"
 
 namespace analyzer {
 
@@ -73,6 +75,58 @@ void AnalyzerTimer::Init(Analyzer* arg_analyzer, analyzer_timer_func arg_timer,
 
 analyzer::ID Analyzer::id_counter = 0;
 
+namespace {
+
+// Charges one delivery into an analyzer to its type's accounting. The
+// time spent in deliveries nested inside of it, e.g. into child or parent
+// analyzers, is charged to those instead.
+class DeliveryCost {
+public:
+	DeliveryCost(AnalyzerAccounting* arg_acct, int len)
+		{
+		acct = arg_acct;
+
+		if ( ! acct )
+			return;
+
+		++acct->deliveries;
+		acct->bytes += len;
+
+		nested = 0;
+		outer = current;
+		current = this;
+		start = std::chrono::steady_clock::now();
+		}
+
+	~DeliveryCost()
+		{
+		if ( ! acct )
+			return;
+
+		auto end = std::chrono::steady_clock::now();
+		uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		acct->nsecs += elapsed > nested ? elapsed - nested : 0;
+
+		current = outer;
+
+		if ( outer )
+			outer->nested += elapsed;
+		}
+
+private:
+	AnalyzerAccounting* acct;
+	DeliveryCost* outer;
+	uint64_t nested;
+	std::chrono::steady_clock::time_point start;
+
+	static DeliveryCost* current;
+};
+
+DeliveryCost* DeliveryCost::current = nullptr;
+
+}
+
 const char* Analyzer::GetAnalyzerName() const
 	{
 	assert(tag);
@@ -82,6 +136,14 @@ const char* Analyzer::GetAnalyzerName() const
 void Analyzer::SetAnalyzerTag(const Tag& arg_tag)
 	{
 	assert(! tag || tag == arg_tag);
+
+	if ( ! accounting && arg_tag && analyzer_accounting )
+		{
+		accounting = analyzer_mgr->GetAccounting(arg_tag);
+		++accounting->instances;
+		++accounting->created;
+		}
+
 	tag = arg_tag;
 	}
 
@@ -118,6 +180,15 @@ void Analyzer::CtorInit(const Tag& arg_tag, Connection* arg_conn)
 	conn = arg_conn;
 	tag = arg_tag;
 	id = ++id_counter;
+	accounting = 0;
+
+	if ( tag && analyzer_accounting )
+		{
+		accounting = analyzer_mgr->GetAccounting(tag);
+		++accounting->instances;
+		++accounting->created;
+		}
+
 	protocol_confirmed = false;
 	timers_canceled = false;
 	skip = false;
@@ -134,6 +205,9 @@ Analyzer::~Analyzer()
 	{
 	assert(finished);
 
+	if ( accounting )
+		--accounting->instances;
+
 	// Make sure any late entries into the analyzer tree are handled (e.g.
 	// from some Done() implementation).
 	LOOP_OVER_GIVEN_CHILDREN(i, new_children)
@@ -225,6 +299,8 @@ void Analyzer::NextPacket(int len, const u_char* data, bool is_orig, uint64_t se
 
 	else
 		{
+		DeliveryCost cost(accounting, len);
+
 		try
 			{
 			DeliverPacket(len, data, is_orig, seq, ip, caplen);
@@ -248,6 +324,8 @@ void Analyzer::NextStream(int len, const u_char* data, bool is_orig)
 
 	else
 		{
+		DeliveryCost cost(accounting, len);
+
 		try
 			{
 			DeliverStream(len, data, is_orig);
@@ -305,17 +383,17 @@ void Analyzer::ForwardPacket(int len, const u_char* data, bool is_orig,
 	AppendNewChildren();
 
 	// Pass to all children.
-	analyzer_list::iterator next;
-	for ( analyzer_list::iterator i = children.begin();
-	      i != children.end(); i = next )
+	for ( size_t i = 0; i < children.size(); )
 		{
-		Analyzer* current = *i;
-		next = ++i;
+		Analyzer* current = children[i];
 
 		if ( ! (current->finished || current->removing ) )
+			{
 			current->NextPacket(len, data, is_orig, seq, ip, caplen);
+			++i;
+			}
 		else
-			DeleteChild(--i);
+			DeleteChild(current);
 		}
 
 	AppendNewChildren();
@@ -328,17 +406,17 @@ void Analyzer::ForwardStream(int len, const u_char* data, bool is_orig)
 
 	AppendNewChildren();
 
-	analyzer_list::iterator next;
-	for ( analyzer_list::iterator i = children.begin();
-	      i != children.end(); i = next )
+	for ( size_t i = 0; i < children.size(); )
 		{
-		Analyzer* current = *i;
-		next = ++i;
+		Analyzer* current = children[i];
 
 		if ( ! (current->finished || current->removing ) )
+			{
 			current->NextStream(len, data, is_orig);
+			++i;
+			}
 		else
-			DeleteChild(--i);
+			DeleteChild(current);
 		}
 
 	AppendNewChildren();
@@ -351,17 +429,17 @@ void Analyzer::ForwardUndelivered(uint64_t seq, int len, bool is_orig)
 
 	AppendNewChildren();
 
-	analyzer_list::iterator next;
-	for ( analyzer_list::iterator i = children.begin();
-	      i != children.end(); i = next )
+	for ( size_t i = 0; i < children.size(); )
 		{
-		Analyzer* current = *i;
-		next = ++i;
+		Analyzer* current = children[i];
 
 		if ( ! (current->finished || current->removing ) )
+			{
 			current->NextUndelivered(seq, len, is_orig);
+			++i;
+			}
 		else
-			DeleteChild(--i);
+			DeleteChild(current);
 		}
 
 	AppendNewChildren();
@@ -371,17 +449,17 @@ void Analyzer::ForwardEndOfData(bool orig)
 	{
 	AppendNewChildren();
 
-	analyzer_list::iterator next;
-	for ( analyzer_list::iterator i = children.begin();
-	      i != children.end(); i = next )
+	for ( size_t i = 0; i < children.size(); )
 		{
-		Analyzer* current = *i;
-		next = ++i;
+		Analyzer* current = children[i];
 
 		if ( ! (current->finished || current->removing ) )
+			{
 			current->NextEndOfData(orig);
+			++i;
+			}
 		else
-			DeleteChild(--i);
+			DeleteChild(current);
 		}
 
 	AppendNewChildren();
@@ -545,10 +623,8 @@ Analyzer* Analyzer::FindChild(const char* name)
 	return tag ? FindChild(tag) : 0;
 	}
 
-void Analyzer::DeleteChild(analyzer_list::iterator i)
+void Analyzer::DeleteChild(Analyzer* child)
 	{
-	Analyzer* child = *i;
-
 	// Analyzer must have already been finished or marked for removal.
 	assert(child->finished || child->removing);
 
@@ -561,6 +637,10 @@ void Analyzer::DeleteChild(analyzer_list::iterator i)
 	DBG_LOG(DBG_ANALYZER, "%s deleted child %s 3",
 		fmt_analyzer(this).c_str(), fmt_analyzer(child).c_str());
 
+	// Look the child up only now: Done() may have run code that
+	// modified the child vector and invalidated any position we held.
+	auto i = std::find(children.begin(), children.end(), child);
+	assert(i != children.end());
 	children.erase(i);
 	delete child;
 	}
@@ -760,6 +840,12 @@ void Analyzer::CancelTimers()
 	// call RemoveTimer(), which would then modify the list we're just
 	// traversing.  Thus, we first make a copy of the list which we then
 	// iterate through.
+	timers_canceled = 1;
+
+	// Most short-lived connections never arm a timer here; skip the copy.
+	if ( timers.length() == 0 )
+		return;
+
 	timer_list tmp(timers.length());
 	std::copy(timers.begin(), timers.end(), back_inserter(tmp));
 
@@ -767,14 +853,15 @@ void Analyzer::CancelTimers()
 	for ( auto timer : tmp )
 		timer_mgr->Cancel(timer);
 
-	timers_canceled = 1;
 	timers.clear();
 	}
 
 void Analyzer::AppendNewChildren()
 	{
-	LOOP_OVER_GIVEN_CHILDREN(i, new_children)
-		children.push_back(*i);
+	if ( new_children.empty() )
+		return;
+
+	children.insert(children.end(), new_children.begin(), new_children.end());
 	new_children.clear();
 	}
 
@@ -866,8 +953,11 @@ void SupportAnalyzer::ForwardPacket(int len, const u_char* data, bool is_orig,
 		// Pass to next in chain.
 		next_sibling->NextPacket(len, data, is_orig, seq, ip, caplen);
 	else
+		{
 		// Finished with preprocessing - now it's the parent's turn.
+		DeliveryCost cost(Parent()->Accounting(), len);
 		Parent()->DeliverPacket(len, data, is_orig, seq, ip, caplen);
+		}
 	}
 
 void SupportAnalyzer::ForwardStream(int len, const u_char* data, bool is_orig)
@@ -886,8 +976,11 @@ void SupportAnalyzer::ForwardStream(int len, const u_char* data, bool is_orig)
 		// Pass to next in chain.
 		next_sibling->NextStream(len, data, is_orig);
 	else
+		{
 		// Finished with preprocessing - now it's the parent's turn.
+		DeliveryCost cost(Parent()->Accounting(), len);
 		Parent()->DeliverStream(len, data, is_orig);
+		}
 	}
 
 void SupportAnalyzer::ForwardUndelivered(uint64_t seq, int len, bool is_orig)
@@ -31,10 +31,22 @@ class AnalyzerTimer;
 class SupportAnalyzer;
 class OutputHandler;
 
-typedef list<Analyzer*> analyzer_list;
+typedef std::vector<Analyzer*> analyzer_list;
 typedef uint32_t ID;
 typedef void (Analyzer::*analyzer_timer_func)(double t);
 
+/**
+ * Cost accounting for all instances of one type of analyzer. This is only
+ * collected if the script-level \c analyzer_accounting option is set.
+ */
+struct AnalyzerAccounting {
+	uint64_t instances = 0;	// currently alive
+	uint64_t created = 0;	// cumulative
+	uint64_t deliveries = 0;	// packets and stream chunks passed in
+	uint64_t bytes = 0;	// bytes passed in
+	uint64_t nsecs = 0;	// time spent, excluding child analyzers
+};
+
 /**
  * Class to receive processed output from an anlyzer.
  */
@@ -343,6 +355,12 @@ public:
 	 */
 	void SetAnalyzerTag(const Tag& tag);
 
+	/**
+	 * Returns the cost accounting for the analyzer's type, or null if
+	 * accounting isn't enabled.
+	 */
+	AnalyzerAccounting* Accounting() const	{ return accounting; }
+
 	/**
 	 * Returns a textual description of the analyzer's type. This is
 	 * what's passed to the constructor and usally corresponds to the
@@ -687,13 +705,14 @@ protected:
 private:
 	// Internal method to eventually delete a child analyzer that's
 	// already Done().
-	void DeleteChild(analyzer_list::iterator i);
+	void DeleteChild(Analyzer* child);
 
 	// Helper for the ctors.
 	void CtorInit(const Tag& tag, Connection* conn);
 
 	Tag tag;
 	ID id;
+	AnalyzerAccounting* accounting;
 
 	Connection* conn;
 	Analyzer* parent;
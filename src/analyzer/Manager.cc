@@ -371,19 +371,23 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 	pia::PIA* pia = 0;
 	bool check_port = false;
 
+	// Metered connections keep the transport layer's own state, which
+	// conn.log is built from, plus size accounting; nothing else.
+	bool metered = IsFlowMetered(conn);
+
 	switch ( conn->ConnTransport() ) {
 
 	case TRANSPORT_TCP:
 		root = tcp = new tcp::TCP_Analyzer(conn);
-		pia = new pia::PIA_TCP(conn);
-		check_port = true;
+		pia = metered ? 0 : new pia::PIA_TCP(conn);
+		check_port = ! metered;
 		DBG_ANALYZER(conn, "activated TCP analyzer");
 		break;
 
 	case TRANSPORT_UDP:
 		root = udp = new udp::UDP_Analyzer(conn);
-		pia = new pia::PIA_UDP(conn);
-		check_port = true;
+		pia = metered ? 0 : new pia::PIA_UDP(conn);
+		check_port = ! metered;
 		DBG_ANALYZER(conn, "activated UDP analyzer");
 		break;
 
@@ -398,7 +402,10 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 		return false;
 	}
 
-	bool scheduled = ApplyScheduledAnalyzers(conn, false, root);
+	if ( metered )
+		DBG_ANALYZER(conn, "flow metering only");
+
+	bool scheduled = ! metered && ApplyScheduledAnalyzers(conn, false, root);
 
 	// Hmm... Do we want *just* the expected analyzer, or all
 	// other potential analyzers as well?  For now we only take
@@ -435,12 +442,13 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 		// asks us to do so.  In all other cases, reassembly may
 		// be turned on later by the TCP PIA.
 
-		bool reass = root->GetChildren().size() ||
-				dpd_reassemble_first_packets ||
-				tcp_content_deliver_all_orig ||
-				tcp_content_deliver_all_resp;
+		bool reass = ! metered &&
+				(root->GetChildren().size() ||
+				 dpd_reassemble_first_packets ||
+				 tcp_content_deliver_all_orig ||
+				 tcp_content_deliver_all_resp);
 
-		if ( tcp_contents && ! reass )
+		if ( tcp_contents && ! reass && ! metered )
 			{
 			auto dport = val_mgr->GetPort(ntohs(conn->RespPort()), TRANSPORT_TCP);
 			Val* result;
@@ -457,7 +465,7 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 		if ( reass )
 			tcp->EnableReassembly();
 
-		if ( IsEnabled(analyzer_stepping) )
+		if ( IsEnabled(analyzer_stepping) && ! metered )
 			{
 			// Add a SteppingStone analyzer if requested.  The port
 			// should really not be hardcoded here, but as it can
@@ -473,7 +481,7 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 				}
 			}
 
-		if ( IsEnabled(analyzer_tcpstats) )
+		if ( IsEnabled(analyzer_tcpstats) && ! metered )
 			// Add TCPStats analyzer. This needs to see packets so
 			// we cannot add it as a normal child.
 			tcp->AddChildPacketAnalyzer(new tcp::TCPStats_Analyzer(conn));
@@ -502,6 +510,31 @@ bool Manager::BuildInitialAnalyzerTree(Connection* conn)
 	return true;
 	}
 
+bool Manager::IsFlowMetered(const Connection* conn) const
+	{
+	if ( flow_meter_nets->Size() )
+		{
+		AddrVal orig(conn->OrigAddr());
+		AddrVal resp(conn->RespAddr());
+
+		if ( flow_meter_nets->Lookup(&orig, false) ||
+		     flow_meter_nets->Lookup(&resp, false) )
+			return true;
+		}
+
+	if ( flow_meter_ports->Size() )
+		{
+		PortVal* p = val_mgr->GetPort(ntohs(conn->RespPort()), conn->ConnTransport());
+		bool found = flow_meter_ports->Lookup(p, false);
+		Unref(p);
+
+		if ( found )
+			return true;
+		}
+
+	return false;
+	}
+
 void Manager::ExpireScheduledAnalyzers()
 	{
 	if ( ! network_time )
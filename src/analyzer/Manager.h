@@ -341,6 +341,21 @@ public:
 	const std::vector<uint16_t>& GetVxlanPorts() const
 		{ return vxlan_ports; }
 
+	/**
+	 * Returns the cost accounting record for an analyzer type, creating
+	 * it if necessary. The pointer remains valid for the lifetime of the
+	 * manager.
+	 */
+	AnalyzerAccounting* GetAccounting(const Tag& tag)
+		{ return &accounting[tag]; }
+
+	/**
+	 * Returns the cost accounting of all analyzer types that have been
+	 * instantiated while accounting was enabled.
+	 */
+	const std::map<Tag, AnalyzerAccounting>& AllAccounting() const
+		{ return accounting; }
+
 private:
 	typedef set<Tag> tag_set;
 	typedef map<uint32_t, tag_set*> analyzer_map_by_port;
@@ -349,6 +364,10 @@ private:
 	tag_set* LookupPort(TransportProto proto, uint32_t port, bool add_if_not_found);
 
 	tag_set GetScheduled(const Connection* conn);
+
+	// True if the connection falls under flow_meter_nets or
+	// flow_meter_ports and thus gets only a bare analyzer tree.
+	bool IsFlowMetered(const Connection* conn) const;
 	void ExpireScheduledAnalyzers();
 
 	analyzer_map_by_port analyzers_by_port_tcp;
@@ -395,6 +414,8 @@ private:
 	conns_map conns;
 	conns_queue conns_by_timeout;
 	std::vector<uint16_t> vxlan_ports;
+
+	std::map<Tag, AnalyzerAccounting> accounting;
 };
 
 }
@@ -22,6 +22,9 @@ DNS_Interpreter::DNS_Interpreter(analyzer::Analyzer* arg_analyzer)
 	{
 	analyzer = arg_analyzer;
 	first_message = true;
+	num_cached_names = 0;
+	name_cache_used = 0;
+	name_clean = true;
 	}
 
 int DNS_Interpreter::ParseMessage(const u_char* data, int len, int is_query)
@@ -36,6 +39,9 @@ int DNS_Interpreter::ParseMessage(const u_char* data, int len, int is_query)
 
 	DNS_MsgInfo msg((DNS_RawMsgHdr*) data, is_query);
 
+	num_cached_names = 0;
+	name_cache_used = 0;
+
 	if ( first_message && msg.QR && is_query == 1 )
 		{
 		is_query = msg.is_query = 0;
@@ -216,8 +222,8 @@ int DNS_Interpreter::ParseAnswer(DNS_MsgInfo* msg,
 				const u_char*& data, int& len,
 				const u_char* msg_start)
 	{
-	u_char name[513];
-	int name_len = sizeof(name) - 1;
+	u_char* name = msg->query_name_buf;
+	int name_len = sizeof(msg->query_name_buf) - 1;
 
 	u_char* name_end = ExtractName(data, len, name, name_len, msg_start);
 
@@ -234,7 +240,8 @@ int DNS_Interpreter::ParseAnswer(DNS_MsgInfo* msg,
 	// re-interpreted by other, more adventurous RR types.
 
 	Unref(msg->query_name);
-	msg->query_name = new StringVal(new BroString(name, name_end - name, 1));
+	msg->query_name = 0;
+	msg->query_name_len = name_end - name;
 	msg->atype = RR_Type(ExtractShort(data, len));
 	msg->aclass = ExtractShort(data, len);
 	msg->ttl = ExtractLong(data, len);
@@ -246,6 +253,13 @@ int DNS_Interpreter::ParseAnswer(DNS_MsgInfo* msg,
 		return 0;
 		}
 
+	if ( ! RR_Wanted(msg, rdlength) )
+		{
+		data += rdlength;
+		len -= rdlength;
+		return 1;
+		}
+
 	int status;
 	switch ( msg->atype ) {
 		case TYPE_A:
@@ -358,6 +372,38 @@ int DNS_Interpreter::ParseAnswer(DNS_MsgInfo* msg,
 	return status;
 	}
 
+bool DNS_Interpreter::RR_Wanted(DNS_MsgInfo* msg, int rdlength) const
+	{
+	// Only RRs that their parser would accept without a weird get
+	// skipped, so that skipping doesn't change what's reported nor
+	// where parsing of a malformed message stops.
+	EventHandlerPtr ev;
+
+	switch ( msg->atype ) {
+		case TYPE_A:
+			if ( rdlength != 4 )
+				return true;
+
+			ev = dns_A_reply;
+			break;
+
+		case TYPE_A6:
+		case TYPE_AAAA:
+			if ( rdlength != 16 )
+				return true;
+
+			ev = msg->atype == TYPE_AAAA ? dns_AAAA_reply : dns_A6_reply;
+			break;
+
+		default:
+			// The other parsers check the inner structure of their
+			// RDATA, which takes parsing it anyway.
+			return true;
+	}
+
+	return ev && ! msg->skip_event;
+	}
+
 u_char* DNS_Interpreter::ExtractName(const u_char*& data, int& len,
 					u_char* name, int name_len,
 					const u_char* msg_start)
@@ -370,7 +416,10 @@ u_char* DNS_Interpreter::ExtractName(const u_char*& data, int& len,
 	int n = name - name_start;
 
 	if ( n >= 255 )
+		{
 		analyzer->Weird("DNS_NAME_too_long");
+		name_clean = false;
+		}
 
 	if ( n >= 2 && name[-1] == '.' )
 		{
@@ -392,7 +441,10 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 				const u_char* msg_start)
 	{
 	if ( len <= 0 )
+		{
+		name_clean = false;
 		return 0;
+		}
 
 	const u_char* orig_data = data;
 	int label_len = data[0];
@@ -401,7 +453,12 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 	--len;
 
 	if ( len <= 0 )
+		{
+		if ( label_len != 0 )
+			name_clean = false;
+
 		return 0;
+		}
 
 	if ( label_len == 0 )
 		// Found terminating label.
@@ -427,16 +484,29 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 			//  sometimes compression points to compression.)
 
 			analyzer->Weird("DNS_label_forward_compress_offset");
+			name_clean = false;
 			return 0;
 			}
 
 		// Recursively resolve name.
 		const u_char* recurse_data = msg_start + offset;
 		int recurse_max_len = orig_data - recurse_data;
+		int bound = recurse_max_len;
+
+		if ( LookupCachedName(offset, bound, name, name_len) )
+			return 0;
+
+		bool outer_clean = name_clean;
+		name_clean = true;
 
 		u_char* name_end = ExtractName(recurse_data, recurse_max_len,
 						name, name_len, msg_start);
 
+		if ( name_clean )
+			CacheName(offset, bound, name, name_end - name);
+
+		name_clean = name_clean && outer_clean;
+
 		name_len -= name_end - name;
 		name = name_end;
 
@@ -448,6 +518,7 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 		analyzer->Weird("DNS_label_len_gt_pkt");
 		data += len;	// consume the rest of the packet
 		len = 0;
+		name_clean = false;
 		return 0;
 		}
 
@@ -456,12 +527,14 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 		ntohs(analyzer->Conn()->RespPort()) != 137 )
 		{
 		analyzer->Weird("DNS_label_too_long");
+		name_clean = false;
 		return 0;
 		}
 
 	if ( label_len >= name_len )
 		{
 		analyzer->Weird("DNS_label_len_gt_name_len");
+		name_clean = false;
 		return 0;
 		}
 
@@ -477,6 +550,50 @@ int DNS_Interpreter::ExtractLabel(const u_char*& data, int& len,
 	return 1;
 	}
 
+bool DNS_Interpreter::LookupCachedName(int offset, int bound, u_char*& name,
+					int& name_len)
+	{
+	for ( int i = 0; i < num_cached_names; ++i )
+		{
+		const CachedName& c = name_cache[i];
+
+		// A name that resolved within some number of bytes resolves
+		// the same way within more, but with fewer the walk may run
+		// out of data and complain.
+		if ( c.offset != offset || c.bound > bound )
+			continue;
+
+		// Leave names that would not fit to the regular path, which
+		// reports the problem.
+		if ( c.len >= name_len )
+			return false;
+
+		memcpy(name, name_cache_data + c.start, c.len);
+		name += c.len;
+		name_len -= c.len;
+		return true;
+		}
+
+	return false;
+	}
+
+void DNS_Interpreter::CacheName(int offset, int bound, const u_char* name,
+				int len)
+	{
+	if ( num_cached_names >= NAME_CACHE_ENTRIES ||
+	     name_cache_used + len > int(sizeof(name_cache_data)) )
+		return;
+
+	CachedName& c = name_cache[num_cached_names++];
+	c.offset = offset;
+	c.bound = bound;
+	c.start = name_cache_used;
+	c.len = len;
+
+	memcpy(name_cache_data + name_cache_used, name, len);
+	name_cache_used += len;
+	}
+
 uint16_t DNS_Interpreter::ExtractShort(const u_char*& data, int& len)
 	{
 	if ( len < 2 )
@@ -1449,6 +1566,7 @@ DNS_MsgInfo::DNS_MsgInfo(DNS_RawMsgHdr* hdr, int arg_is_query)
 	is_query = arg_is_query;
 
 	query_name = 0;
+	query_name_len = 0;
 	atype = TYPE_ALL;
 	aclass = 0;
 	ttl = 0;
@@ -1462,6 +1580,16 @@ DNS_MsgInfo::~DNS_MsgInfo()
 	Unref(query_name);
 	}
 
+StringVal* DNS_MsgInfo::QueryName()
+	{
+	if ( ! query_name )
+		query_name = new StringVal(new BroString(query_name_buf,
+							query_name_len, 1));
+
+	Ref(query_name);
+	return query_name;
+	}
+
 Val* DNS_MsgInfo::BuildHdrVal()
 	{
 	RecordVal* r = new RecordVal(dns_msg);
@@ -1487,9 +1615,8 @@ Val* DNS_MsgInfo::BuildAnswerVal()
 	{
 	RecordVal* r = new RecordVal(dns_answer);
 
-	Ref(query_name);
 	r->Assign(0, val_mgr->GetCount(int(answer_type)));
-	r->Assign(1, query_name);
+	r->Assign(1, QueryName());
 	r->Assign(2, val_mgr->GetCount(atype));
 	r->Assign(3, val_mgr->GetCount(aclass));
 	r->Assign(4, new IntervalVal(double(ttl), Seconds));
@@ -1503,9 +1630,8 @@ Val* DNS_MsgInfo::BuildEDNS_Val()
 	// than a regular resource record.
 	RecordVal* r = new RecordVal(dns_edns_additional);
 
-	Ref(query_name);
 	r->Assign(0, val_mgr->GetCount(int(answer_type)));
-	r->Assign(1, query_name);
+	r->Assign(1, QueryName());
 
 	// type = 0x29 or 41 = EDNS
 	r->Assign(2, val_mgr->GetCount(atype));
@@ -1538,9 +1664,8 @@ Val* DNS_MsgInfo::BuildTSIG_Val(struct TSIG_DATA* tsig)
 	RecordVal* r = new RecordVal(dns_tsig_additional);
 	double rtime = tsig->time_s + tsig->time_ms / 1000.0;
 
-	Ref(query_name);
 	// r->Assign(0, val_mgr->GetCount(int(answer_type)));
-	r->Assign(0, query_name);
+	r->Assign(0, QueryName());
 	r->Assign(1, val_mgr->GetCount(int(answer_type)));
 	r->Assign(2, new StringVal(tsig->alg_name));
 	r->Assign(3, new StringVal(tsig->sig));
@@ -1557,8 +1682,7 @@ Val* DNS_MsgInfo::BuildRRSIG_Val(RRSIG_DATA* rrsig)
 	{
 	RecordVal* r = new RecordVal(dns_rrsig_rr);
 
-	Ref(query_name);
-	r->Assign(0, query_name);
+	r->Assign(0, QueryName());
 	r->Assign(1, val_mgr->GetCount(int(answer_type)));
 	r->Assign(2, val_mgr->GetCount(rrsig->type_covered));
 	r->Assign(3, val_mgr->GetCount(rrsig->algorithm));
@@ -1578,8 +1702,7 @@ Val* DNS_MsgInfo::BuildDNSKEY_Val(DNSKEY_DATA* dnskey)
 	{
 	RecordVal* r = new RecordVal(dns_dnskey_rr);
 
-	Ref(query_name);
-	r->Assign(0, query_name);
+	r->Assign(0, QueryName());
 	r->Assign(1, val_mgr->GetCount(int(answer_type)));
 	r->Assign(2, val_mgr->GetCount(dnskey->dflags));
 	r->Assign(3, val_mgr->GetCount(dnskey->dprotocol));
@@ -1594,8 +1717,7 @@ Val* DNS_MsgInfo::BuildNSEC3_Val(NSEC3_DATA* nsec3)
 	{
 	RecordVal* r = new RecordVal(dns_nsec3_rr);
 
-	Ref(query_name);
-	r->Assign(0, query_name);
+	r->Assign(0, QueryName());
 	r->Assign(1, val_mgr->GetCount(int(answer_type)));
 	r->Assign(2, val_mgr->GetCount(nsec3->nsec_flags));
 	r->Assign(3, val_mgr->GetCount(nsec3->nsec_hash_algo));
@@ -1614,8 +1736,7 @@ Val* DNS_MsgInfo::BuildDS_Val(DS_DATA* ds)
 	{
 	RecordVal* r = new RecordVal(dns_ds_rr);
 
-	Ref(query_name);
-	r->Assign(0, query_name);
+	r->Assign(0, QueryName());
 	r->Assign(1, val_mgr->GetCount(int(answer_type)));
 	r->Assign(2, val_mgr->GetCount(ds->key_tag));
 	r->Assign(3, val_mgr->GetCount(ds->algorithm));
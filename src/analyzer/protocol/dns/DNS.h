@@ -189,6 +189,10 @@ public:
 	Val* BuildNSEC3_Val(struct NSEC3_DATA*);
 	Val* BuildDS_Val(struct DS_DATA*);
 
+	// Returns the current RR's name, building the value on first use.
+	// Caller gets a new reference.
+	StringVal* QueryName();
+
 	int id;
 	int opcode;	///< query type, see DNS_Opcode
 	int rcode;	///< return code, see DNS_Code
@@ -204,7 +208,9 @@ public:
 	int arcount;	///< number of additional RRs
 	int is_query;	///< whether it came from the session initiator
 
-	StringVal* query_name;
+	StringVal* query_name;	///< created lazily from query_name_buf
+	u_char query_name_buf[513];
+	int query_name_len;
 	RR_Type atype;
 	int aclass;	///< normally = 1, inet
 	uint32_t ttl;
@@ -311,8 +317,37 @@ protected:
 					const u_char*& data, int& len,
 					BroString* question_name);
 
+	// Returns false if the current RR's RDATA can be skipped: nothing
+	// would see its event, and it's a fixed-size RR whose rdlength shows
+	// that parsing it couldn't raise a weird.
+	bool RR_Wanted(DNS_MsgInfo* msg, int rdlength) const;
+
+	// Names already resolved through a compression pointer in the
+	// current message.  bound is the number of bytes the walk from the
+	// pointer's target may cover, which depends on where the pointer is.
+	bool LookupCachedName(int offset, int bound, u_char*& name,
+				int& name_len);
+	void CacheName(int offset, int bound, const u_char* name, int len);
+
 	analyzer::Analyzer* analyzer;
 	bool first_message;
+
+	struct CachedName {
+		uint16_t offset;
+		int bound;
+		uint16_t start;
+		uint16_t len;
+	};
+
+	static const int NAME_CACHE_ENTRIES = 16;
+	CachedName name_cache[NAME_CACHE_ENTRIES];
+	int num_cached_names;
+	u_char name_cache_data[1024];
+	int name_cache_used;
+
+	// False once the name being extracted hits anything unusual; such
+	// names are not cached, so their weirds are reported every time.
+	bool name_clean;
 };
 
 
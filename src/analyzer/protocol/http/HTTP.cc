@@ -13,6 +13,7 @@
 #include "Event.h"
 #include "analyzer/protocol/mime/MIME.h"
 #include "file_analysis/Manager.h"
+#include "RuleMatcher.h"
 
 #include "events.bif.h"
 
@@ -47,6 +48,7 @@ HTTP_Entity::HTTP_Entity(HTTP_Message *arg_message, MIME_Entity* parent_entity,
 	body_length = 0;
 	header_length = 0;
 	deliver_body = true;
+	fast_forward = false;
 	encoding = IDENTITY;
 	zip = 0;
 	is_partial_content = false;
@@ -187,6 +189,14 @@ private:
 
 void HTTP_Entity::DeliverBody(int len, const char* data, int trailing_CRLF)
 	{
+	if ( fast_forward )
+		{
+		body_length += len;
+		if ( trailing_CRLF )
+			body_length += 2;
+		return;
+		}
+
 	if ( encoding == GZIP || encoding == DEFLATE )
 		{
 		zip::ZIP_Analyzer::Method method =
@@ -346,6 +356,46 @@ void HTTP_Entity::SubmitData(int len, const char* buf)
 	send_size = false;
 	}
 
+void HTTP_Entity::SkipBody()
+	{
+	deliver_body = 0;
+
+	// Once the headers are in, we may be able to stop handling the
+	// rest of the body right away.
+	if ( ! in_header )
+		fast_forward = ! BodyWanted();
+	}
+
+bool HTTP_Entity::BodyWanted() const
+	{
+	// Sub-entities are parsed out of the body.
+	if ( content_type == mime::CONTENT_TYPE_MULTIPART ||
+	     content_type == mime::CONTENT_TYPE_MESSAGE )
+		return true;
+
+	// The body length we report counts decompressed bytes.
+	if ( encoding != IDENTITY )
+		return true;
+
+	// Feeds http_entity_data and file analysis.
+	if ( deliver_body )
+		return true;
+
+	Rule::PatternType rule =
+		http_message->IsOrig() ?
+			Rule::HTTP_REQUEST_BODY : Rule::HTTP_REPLY_BODY;
+
+	if ( rule_matcher && rule_matcher->HasPatternType(rule) )
+		return true;
+
+	HTTP_Analyzer* a = http_message->MyHTTP_Analyzer();
+
+	if ( ! a->GetChildren().empty() || a->GetOutputHandler() )
+		return true;
+
+	return false;
+	}
+
 void HTTP_Entity::SetPlainDelivery(int64_t length)
 	{
 	ASSERT(length >= 0);
@@ -537,6 +587,8 @@ void HTTP_Entity::SubmitAllHeaders()
 		return;
 		}
 
+	fast_forward = ! BodyWanted();
+
 	if ( content_type == mime::CONTENT_TYPE_MULTIPART ||
 	     content_type == mime::CONTENT_TYPE_MESSAGE )
 		{
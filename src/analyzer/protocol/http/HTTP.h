@@ -42,7 +42,7 @@ public:
 	int Undelivered(int64_t len);
 	int64_t BodyLength() const 		{ return body_length; }
 	int64_t HeaderLength() const 	{ return header_length; }
-	void SkipBody() 		{ deliver_body = 0; }
+	void SkipBody();
 	const string& FileID() const  { return precomputed_file_id; }
 
 protected:
@@ -58,6 +58,7 @@ protected:
 	int64_t body_length;
 	int64_t header_length;
 	int deliver_body;
+	bool fast_forward; // only account for body bytes, don't process them
 	enum { IDENTITY, GZIP, COMPRESS, DEFLATE } encoding;
 	zip::ZIP_Analyzer* zip;
 	bool is_partial_content;
@@ -75,6 +76,9 @@ protected:
 
 	void SetPlainDelivery(int64_t length);
 
+	// Returns true if anything may look at the bytes of the body.
+	bool BodyWanted() const;
+
 	void SubmitHeader(mime::MIME_Header* h) override;
 	void SubmitAllHeaders() override;
 };
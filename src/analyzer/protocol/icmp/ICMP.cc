@@ -8,6 +8,7 @@
 
 #include "IP.h"
 #include "Net.h"
+#include "iosource/Packet.h"
 #include "NetVar.h"
 #include "Event.h"
 #include "Conn.h"
@@ -49,7 +50,8 @@ void ICMP_Analyzer::DeliverPacket(int len, const u_char* data,
 
 	const struct icmp* icmpp = (const struct icmp*) data;
 
-	if ( ! ignore_checksums && caplen >= len )
+	if ( ! ignore_checksums && caplen >= len &&
+	     ! (current_pkt && current_pkt->l4_checksummed) )
 		{
 		int chksum = 0;
 
@@ -131,6 +131,14 @@ static data_chunk_t get_data_chunk(BroString* s)
 	return b;
 	}
 
+// Characters that quoted-printable passes through unchanged: printables
+// except '=', plus whitespace.
+static inline bool is_qp_literal(char ch)
+	{
+	return (ch >= 33 && ch <= 60) || (ch >= 62 && ch <= 126) ||
+		ch == HT || ch == SP;
+	}
+
 int fputs(data_chunk_t b, FILE* fp)
 	{
 	for ( int i = 0; i < b.length; ++i )
@@ -437,28 +445,22 @@ using namespace analyzer::mime;
 
 MIME_Multiline::MIME_Multiline()
 	{
-	line = 0;
 	}
 
 MIME_Multiline::~MIME_Multiline()
 	{
-	delete line;
-	delete_strings(buffer);
 	}
 
 void MIME_Multiline::append(int len, const char* data)
 	{
-	buffer.push_back(new BroString((const u_char*) data, len, 1));
+	buffer.append(data, len);
 	}
 
-BroString* MIME_Multiline::get_concatenated_line()
+data_chunk_t MIME_Multiline::get_concatenated_line() const
 	{
-	if ( buffer.size() == 0 )
-		return 0;
-
-	delete line;
-	line = concatenate(buffer);
-
+	data_chunk_t line;
+	line.length = buffer.size();
+	line.data = buffer.data();
 	return line;
 	}
 
@@ -468,9 +470,9 @@ MIME_Header::MIME_Header(MIME_Multiline* hl)
 	lines = hl;
 	name = value = value_token = rest_value = null_data_chunk;
 
-	BroString* s = hl->get_concatenated_line();
-	int len = s->Len();
-	const char* data = (const char*) s->Bytes();
+	data_chunk_t s = hl->get_concatenated_line();
+	int len = s.length;
+	const char* data = s.data;
 
 	int offset = MIME_get_field_name(len, data, &name);
 	if ( offset < 0 )
@@ -1071,6 +1073,19 @@ void MIME_Entity::DecodeQuotedPrintable(int len, const char* data)
 
 	for ( i = 0; i <= end_of_line; ++i )
 		{
+		// Pass runs of literal characters on in one piece, which
+		// leaves only '=' and control characters for below.
+		int run = i;
+		while ( run <= end_of_line && is_qp_literal(data[run]) )
+			++run;
+
+		if ( run > i )
+			{
+			DataOctets(run - i, data + i);
+			i = run - 1;
+			continue;
+			}
+
 		if ( data[i] == '=' )
 			{
 			if ( i == end_of_line )
@@ -1102,14 +1117,6 @@ void MIME_Entity::DecodeQuotedPrintable(int len, const char* data)
 				}
 			}
 
-		else if ( (data[i] >= 33 && data[i] <= 60) ||
-			   // except controls, whitespace and '='
-			  (data[i] >= 62 && data[i] <= 126) )
-			DataOctet(data[i]);
-
-		else if ( data[i] == HT || data[i] == SP )
-			DataOctet(data[i]);
-
 		else
 			{
 			IllegalEncoding(fmt("control characters in quoted-printable encoding: %d", (int) (data[i])));
@@ -1131,10 +1138,34 @@ void MIME_Entity::DecodeBase64(int len, const char* data)
 
 	while ( len > 0 )
 		{
-		rlen = 128;
-		char* prbuf = rbuf;
-		int decoded = base64_decoder->Decode(len, data, &rlen, &prbuf);
-		DataOctets(rlen, rbuf);
+		if ( data_buf_offset < 0 && ! GetDataBuffer() )
+			return;
+
+		int decoded;
+
+		if ( data_buf_length - data_buf_offset >= 3 )
+			{
+			// Decode straight into the data buffer.
+			rlen = data_buf_length - data_buf_offset;
+			char* prbuf = data_buf_data + data_buf_offset;
+			decoded = base64_decoder->Decode(len, data, &rlen, &prbuf);
+			data_buf_offset += rlen;
+
+			if ( data_buf_offset == data_buf_length )
+				{
+				SubmitData(data_buf_length, data_buf_data);
+				data_buf_offset = -1;
+				}
+			}
+		else
+			{
+			// Not enough room left for a full group.
+			rlen = 128;
+			char* prbuf = rbuf;
+			decoded = base64_decoder->Decode(len, data, &rlen, &prbuf);
+			DataOctets(rlen, rbuf);
+			}
+
 		len -= decoded; data += decoded;
 		}
 	}
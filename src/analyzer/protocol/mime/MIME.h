@@ -58,11 +58,13 @@ public:
 	~MIME_Multiline();
 
 	void append(int len, const char* data);
-	BroString* get_concatenated_line();
+
+	// The header with its continuation lines joined. The data stays
+	// valid as long as the object lives and nothing is appended.
+	data_chunk_t get_concatenated_line() const;
 
 protected:
-	vector<const BroString*> buffer;
-	BroString* line;
+	std::string buffer;
 };
 
 class MIME_Header {
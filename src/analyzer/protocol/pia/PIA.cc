@@ -5,14 +5,65 @@
 #include "IP.h"
 #include "DebugLogger.h"
 #include "Reporter.h"
+#include "analyzer/Manager.h"
 #include "analyzer/protocol/tcp/TCP_Flags.h"
 #include "analyzer/protocol/tcp/TCP_Reassembler.h"
 
 using namespace analyzer::pia;
 
+namespace {
+
+bool has_prefix(const u_char* data, int len, const char* prefix)
+	{
+	int n = strlen(prefix);
+	return len >= n && memcmp(data, prefix, n) == 0;
+	}
+
+// Returns the name of the analyzer that a direction's first payload
+// unambiguously belongs to, or null if it's not obvious.  Everything
+// here must be cheap and should err on the side of saying nothing;
+// signature matching takes over then.
+const char* fingerprint_first_bytes(const u_char* data, int len, bool is_orig)
+	{
+	// Either side may speak first.
+	if ( has_prefix(data, len, "SSH-") )
+		return "SSH";
+
+	if ( ! is_orig )
+		return 0;
+
+	// A TLS handshake record (SSL 3.0 to TLS 1.3 record versions)
+	// carrying a ClientHello.
+	if ( len >= 6 && data[0] == 0x16 && data[1] == 0x03 && data[2] <= 0x04 &&
+	     data[5] == 0x01 )
+		return "SSL";
+
+	// An NBSS session message carrying SMB1 or SMB2.
+	if ( len >= 8 && data[0] == 0x00 &&
+	     (memcmp(data + 4, "\xffSMB", 4) == 0 ||
+	      memcmp(data + 4, "\xfeSMB", 4) == 0) )
+		return "SMB";
+
+	static const char* http_methods[] = {
+		"GET /", "POST /", "HEAD /", "PUT /", "OPTIONS ", "DELETE /",
+		"CONNECT ", 0
+	};
+
+	for ( int i = 0; http_methods[i]; ++i )
+		{
+		if ( has_prefix(data, len, http_methods[i]) )
+			return "HTTP";
+		}
+
+	return 0;
+	}
+
+}
+
 PIA::PIA(analyzer::Analyzer* arg_as_analyzer)
 	: state(INIT), as_analyzer(arg_as_analyzer), conn(), current_packet()
 	{
+	first_bytes_checked[0] = first_bytes_checked[1] = false;
 	}
 
 PIA::~PIA()
@@ -79,6 +130,45 @@ void PIA::ReplayPacketBuffer(analyzer::Analyzer* analyzer)
 		analyzer->DeliverPacket(b->len, b->data, b->is_orig, -1, b->ip, 0);
 	}
 
+bool PIA::MatchFirstBytes(const u_char* data, int len, bool is_orig)
+	{
+	if ( ! dpd_match_first_bytes || first_bytes_checked[is_orig] || len <= 0 )
+		return false;
+
+	first_bytes_checked[is_orig] = true;
+
+	// The fingerprints are all for protocols running over TCP.
+	if ( AsAnalyzer()->Conn()->ConnTransport() != TRANSPORT_TCP )
+		return false;
+
+	const char* name = fingerprint_first_bytes(data, len, is_orig);
+
+	if ( ! name )
+		return false;
+
+	analyzer::Tag tag = analyzer_mgr->GetComponentTag(name);
+	analyzer::Analyzer* parent = AsAnalyzer()->Parent();
+
+	if ( ! tag || ! parent || ! analyzer_mgr->IsEnabled(tag) )
+		return false;
+
+	if ( ! parent->HasChildAnalyzer(tag) )
+		{
+		DBG_LOG(DBG_ANALYZER, "PIA first bytes identify %s", name);
+		ActivateAnalyzer(tag);
+		}
+
+	// The analyzer may have been prevented for this connection, in
+	// which case we keep looking.
+	return parent->HasChildAnalyzer(tag);
+	}
+
+void PIA::StopBuffering()
+	{
+	ClearBuffer(&pkt_buffer);
+	pkt_buffer.state = SKIPPING;
+	}
+
 void PIA::PIA_Done()
 	{
 	FinishEndpointMatcher();
@@ -109,6 +199,13 @@ void PIA::PIA_DeliverPacket(int len, const u_char* data, bool is_orig, uint64_t
 						SKIPPING : MATCHING_ONLY;
 		}
 
+	if ( MatchFirstBytes(data, len, is_orig) )
+		{
+		StopBuffering();
+		current_packet.data = 0;
+		return;
+		}
+
 	// FIXME: I'm not sure why it does not work with eol=true...
 	DoMatch(data, len, is_orig, true, false, false, ip);
 
@@ -278,6 +375,12 @@ void PIA_TCP::DeliverStream(int len, const u_char* data, bool is_orig)
 						SKIPPING : MATCHING_ONLY;
 		}
 
+	if ( MatchFirstBytes(data, len, is_orig) )
+		{
+		StopBuffering();
+		return;
+		}
+
 	DoMatch(data, len, is_orig, false, false, false, 0);
 
 	stream_buffer.state = new_state;
@@ -427,6 +530,13 @@ void PIA_TCP::DeactivateAnalyzer(analyzer::Tag tag)
 	reporter->InternalError("PIA_TCP::Deact not implemented yet");
 	}
 
+void PIA_TCP::StopBuffering()
+	{
+	PIA::StopBuffering();
+	ClearBuffer(&stream_buffer);
+	stream_buffer.state = SKIPPING;
+	}
+
 void PIA_TCP::ReplayStreamBuffer(analyzer::Analyzer* analyzer)
 	{
 	DBG_LOG(DBG_ANALYZER, "PIA_TCP replaying %d total stream bytes", stream_buffer.size);
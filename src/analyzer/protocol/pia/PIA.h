@@ -77,6 +77,15 @@ protected:
 	void DoMatch(const u_char* data, int len, bool is_orig, bool bol,
 			bool eol, bool clear_state, const IP_Hdr* ip = 0);
 
+	// Checks a direction's first payload against cheap fingerprints
+	// ahead of signature matching (see dpd_match_first_bytes).  Returns
+	// true if that put an analyzer in charge, in which case the caller
+	// should stop buffering and matching altogether.
+	bool MatchFirstBytes(const u_char* data, int len, bool is_orig);
+
+	// Drops all buffered input and stops looking at further input.
+	virtual void StopBuffering();
+
 	void SetConn(Connection* c)	{ conn = c; }
 
 	Buffer pkt_buffer;
@@ -85,6 +94,7 @@ private:
 	analyzer::Analyzer* as_analyzer;
 	Connection* conn;
 	DataBlock current_packet;
+	bool first_bytes_checked[2];
 };
 
 // PIA for UDP.
@@ -164,6 +174,8 @@ protected:
 					const Rule* rule = 0) override;
 	void DeactivateAnalyzer(analyzer::Tag tag) override;
 
+	void StopBuffering() override;
+
 private:
 	// FIXME: Not sure yet whether we need both pkt_buffer and stream_buffer.
 	// In any case, it's easier this way...
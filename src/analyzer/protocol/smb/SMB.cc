@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cstring>
+
 #include "SMB.h"
+#include "file_analysis/Manager.h"
 
 using namespace analyzer::smb;
 
@@ -6,12 +10,48 @@ using namespace analyzer::smb;
 // being seen.
 #define SMB_MAX_LEN (1<<18)
 
+namespace {
+
+const uint64_t NBSS_HDR_LEN = 4;
+const uint64_t SMB2_HDR_LEN = 64;
+
+// Size of the fixed part of a WRITE request and READ response, which
+// is all we need to see before the data region.
+const uint64_t SMB2_WRITE_REQUEST_LEN = 48;
+const uint64_t SMB2_READ_RESPONSE_LEN = 16;
+
+// Upper bound on what we buffer up front; data offsets beyond this
+// leave the message to the parser.
+const uint64_t SMB2_MAX_PREFIX_LEN = 512;
+
+const uint16_t SMB2_READ = 8;
+const uint16_t SMB2_WRITE = 9;
+
+uint16_t le16(const u_char* p)
+	{
+	return p[0] | (p[1] << 8);
+	}
+
+uint32_t le32(const u_char* p)
+	{
+	return uint32_t(le16(p)) | (uint32_t(le16(p + 2)) << 16);
+	}
+
+uint64_t le64(const u_char* p)
+	{
+	return uint64_t(le32(p)) | (uint64_t(le32(p + 4)) << 32);
+	}
+
+}
+
 SMB_Analyzer::SMB_Analyzer(Connection *conn)
 : tcp::TCP_ApplicationAnalyzer("SMB", conn)
 	{
 	chunks=0;
 	interp = new binpac::SMB::SMB_Conn(this);
 	need_sync=true;
+	ResetFraming(true);
+	ResetFraming(false);
 	}
 
 SMB_Analyzer::~SMB_Analyzer()
@@ -54,9 +94,192 @@ void SMB_Analyzer::NeedResync()
 	{
 	interp->upflow()->flow_buffer()->DiscardData();
 	interp->downflow()->flow_buffer()->DiscardData();
+	interp->set_smb2_streamed_data_len(0);
+	ResetFraming(true);
+	ResetFraming(false);
 	need_sync=true;
 	}
 
+void SMB_Analyzer::ResetFraming(bool orig)
+	{
+	Framing& f = framing[orig];
+	f.state = FRAMING_PREFIX;
+	f.prefix.clear();
+	f.remaining = 0;
+	f.data_remaining = 0;
+	f.file_offset = 0;
+	f.file_id.clear();
+	}
+
+uint64_t SMB_Analyzer::ExaminePrefix(bool orig)
+	{
+	Framing& f = framing[orig];
+	const u_char* p = reinterpret_cast<const u_char*>(f.prefix.data());
+	uint64_t have = f.prefix.size();
+
+	if ( have < NBSS_HDR_LEN )
+		return NBSS_HDR_LEN;
+
+	uint64_t msg_len = NBSS_HDR_LEN + ((p[1] << 16) | (p[2] << 8) | p[3]);
+	uint64_t fixed_len = orig ? SMB2_WRITE_REQUEST_LEN : SMB2_READ_RESPONSE_LEN;
+	uint64_t need = NBSS_HDR_LEN + SMB2_HDR_LEN + fixed_len;
+
+	if ( ! BifConst::SMB::stream_file_data || p[0] != 0 || msg_len < need )
+		return PassPrefixToParser(orig, msg_len);
+
+	if ( have < need )
+		return need;
+
+	// Only plain (non-compound, successful) WRITE requests and READ
+	// responses on non-pipe trees qualify; those are the ones the
+	// parser would just pass on to file analysis.
+	const u_char* smb = p + NBSS_HDR_LEN;
+	uint32_t data_offset = le16(smb + SMB2_HDR_LEN + 2);
+	uint32_t data_len = le32(smb + SMB2_HDR_LEN + 4);
+
+	if ( memcmp(smb, "\xfeSMB", 4) != 0 ||
+	     le16(smb + 4) != SMB2_HDR_LEN ||
+	     le32(smb + 8) != 0 ||
+	     le16(smb + 12) != (orig ? SMB2_WRITE : SMB2_READ) ||
+	     le32(smb + 20) != 0 ||
+	     data_len == 0 ||
+	     data_offset < SMB2_HDR_LEN + fixed_len ||
+	     NBSS_HDR_LEN + data_offset > SMB2_MAX_PREFIX_LEN ||
+	     NBSS_HDR_LEN + data_offset + data_len > msg_len )
+		return PassPrefixToParser(orig, msg_len);
+
+	uint64_t tree_id = orig ? le32(smb + 36)
+	                        : interp->get_request_tree_id(le64(smb + 24));
+
+	if ( interp->get_tree_is_pipe(tree_id) )
+		return PassPrefixToParser(orig, msg_len);
+
+	if ( have < NBSS_HDR_LEN + data_offset )
+		return NBSS_HDR_LEN + data_offset;
+
+	StartStream(orig, msg_len, data_offset, data_len);
+	return 0;
+	}
+
+uint64_t SMB_Analyzer::PassPrefixToParser(bool orig, uint64_t msg_len)
+	{
+	Framing& f = framing[orig];
+	const u_char* p = reinterpret_cast<const u_char*>(f.prefix.data());
+
+	interp->NewData(orig, p, p + f.prefix.size());
+	f.remaining = msg_len - f.prefix.size();
+	f.state = f.remaining > 0 ? FRAMING_PARSER : FRAMING_PREFIX;
+	f.prefix.clear();
+	return 0;
+	}
+
+void SMB_Analyzer::StartStream(bool orig, uint64_t msg_len,
+                               uint32_t data_offset, uint32_t data_len)
+	{
+	Framing& f = framing[orig];
+	u_char* p = reinterpret_cast<u_char*>(&f.prefix[0]);
+	uint64_t have = f.prefix.size();
+
+	// Give the parser the message up to the data region, as if it
+	// carried no data, and tell it the real length for the events.
+	p[1] = (data_offset >> 16) & 0xff;
+	p[2] = (data_offset >> 8) & 0xff;
+	p[3] = data_offset & 0xff;
+	memset(p + NBSS_HDR_LEN + SMB2_HDR_LEN + 4, 0, 4);
+
+	interp->clear_smb2_streamed_data_offset();
+	interp->set_smb2_streamed_data_len(data_len);
+	interp->NewData(orig, p, p + have);
+	interp->set_smb2_streamed_data_len(0);
+
+	f.state = FRAMING_STREAM;
+	f.remaining = msg_len - have;
+	f.data_remaining = data_len;
+	f.prefix.clear();
+
+	// Unless the parser got as far as the READ or WRITE itself, there's
+	// no telling where in the file the data goes, so it gets dropped.
+	if ( ! interp->has_smb2_streamed_data_offset() )
+		return;
+
+	f.file_offset = interp->get_smb2_streamed_data_offset();
+	f.file_id = file_mgr->GetFileID(GetAnalyzerTag(), Conn(), orig);
+
+	// Nobody's interested, so the data can go straight to the floor.
+	if ( ! f.file_id.empty() && file_mgr->IsIgnored(f.file_id) )
+		f.file_id.clear();
+	}
+
+void SMB_Analyzer::DeliverMessages(int len, const u_char* data, bool orig)
+	{
+	Framing& f = framing[orig];
+
+	for ( ; ; )
+		{
+		switch ( f.state ) {
+		case FRAMING_PREFIX:
+			{
+			uint64_t need = ExaminePrefix(orig);
+
+			if ( need == 0 )
+				break;
+
+			if ( len == 0 )
+				return;
+
+			int n = std::min(need - f.prefix.size(), uint64_t(len));
+			f.prefix.append(reinterpret_cast<const char*>(data), n);
+			data += n;
+			len -= n;
+			}
+			break;
+
+		case FRAMING_PARSER:
+			{
+			if ( len == 0 )
+				return;
+
+			int n = std::min(f.remaining, uint64_t(len));
+			interp->NewData(orig, data, data + n);
+			data += n;
+			len -= n;
+
+			f.remaining -= n;
+			if ( f.remaining == 0 )
+				f.state = FRAMING_PREFIX;
+			}
+			break;
+
+		case FRAMING_STREAM:
+			{
+			if ( len == 0 )
+				return;
+
+			int n = std::min(f.remaining, uint64_t(len));
+			int data_n = std::min(f.data_remaining, uint64_t(n));
+
+			if ( data_n > 0 && ! f.file_id.empty() )
+				{
+				// An empty ID back means the file is done with.
+				f.file_id = file_mgr->DataIn(data, data_n, f.file_offset,
+				                             GetAnalyzerTag(), Conn(), orig,
+				                             f.file_id);
+				}
+
+			f.file_offset += data_n;
+			f.data_remaining -= data_n;
+			data += n;
+			len -= n;
+
+			f.remaining -= n;
+			if ( f.remaining == 0 )
+				ResetFraming(orig);
+			}
+			break;
+		}
+		}
+	}
+
 void SMB_Analyzer::DeliverStream(int len, const u_char* data, bool orig)
 	{
 	TCP_ApplicationAnalyzer::DeliverStream(len, data, orig);
@@ -72,7 +295,7 @@ void SMB_Analyzer::DeliverStream(int len, const u_char* data, bool orig)
 	try
 		{
 		// If we get here, it means we have an SMB header in the message.
-		interp->NewData(orig, data, data + len);
+		DeliverMessages(len, data, orig);
 
 		// Let's assume that if there are no binpac exceptions after
 		// 3 data chunks that this is probably actually SMB.
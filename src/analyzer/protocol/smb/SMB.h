@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "analyzer/protocol/tcp/TCP.h"
 #include "smb_pac.h"
 
@@ -22,7 +24,37 @@ public:
 		{ return new SMB_Analyzer(conn); }
 
 protected:
+	// We track NBSS message boundaries ourselves so that the data
+	// region of SMB2 READ responses and WRITE requests can be streamed
+	// into file analysis as it arrives, instead of being buffered by
+	// the parser until the whole message is there.
+	enum FramingState {
+		FRAMING_PREFIX,	// collecting a message's leading bytes
+		FRAMING_PARSER,	// passing the rest of the message to the parser
+		FRAMING_STREAM,	// passing the data region to file analysis
+	};
+
+	struct Framing {
+		FramingState state;
+		std::string prefix;
+		uint64_t remaining;	// bytes left in the current message
+		uint64_t data_remaining;	// bytes left in its data region
+		uint64_t file_offset;
+		std::string file_id;	// empty if nobody wants the data
+	};
+
+	void ResetFraming(bool orig);
+	void DeliverMessages(int len, const u_char* data, bool orig);
+
+	// Looks at the buffered prefix.  Returns the number of bytes
+	// needed before a decision can be made, or 0 once it's been made.
+	uint64_t ExaminePrefix(bool orig);
+	uint64_t PassPrefixToParser(bool orig, uint64_t msg_len);
+	void StartStream(bool orig, uint64_t msg_len, uint32_t data_offset,
+	                 uint32_t data_len);
+
 	binpac::SMB::SMB_Conn* interp;
+	Framing framing[2];
 
 	// Count the number of chunks received by the analyzer
 	// but only used to count the first few.
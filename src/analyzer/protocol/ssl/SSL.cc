@@ -5,6 +5,7 @@
 #include "util.h"
 
 #include "events.bif.h"
+#include "consts.bif.h"
 #include "ssl_pac.h"
 #include "tls-handshake_pac.h"
 
@@ -16,6 +17,7 @@ SSL_Analyzer::SSL_Analyzer(Connection* c)
 	interp = new binpac::SSL::SSL_Conn(this);
 	handshake_interp = new binpac::TLSHandshake::Handshake_Conn(this);
 	had_gap = false;
+	handshake_only_checked = false;
 	}
 
 SSL_Analyzer::~SSL_Analyzer()
@@ -69,6 +71,34 @@ void SSL_Analyzer::DeliverStream(int len, const u_char* data, bool orig)
 		{
 		ProtocolViolation(fmt("Binpac exception: %s", e.c_msg()));
 		}
+
+	if ( BifConst::SSL::handshake_only && ! handshake_only_checked )
+		CheckHandshakeOnly();
+	}
+
+void SSL_Analyzer::CheckHandshakeOnly()
+	{
+	// Past the handshake there's nothing left to parse but encrypted
+	// record headers; if nobody wants to see those, stop paying for
+	// reassembly of what is usually the bulk of the connection.
+	if ( ! interp->isEstablished() || ssl_encrypted_data )
+		return;
+
+	handshake_only_checked = true;
+
+	// Only do this when we sit directly on top of TCP and are the only
+	// consumer of the stream there (STARTTLS puts us below another
+	// application analyzer, which still wants its data).
+	if ( Parent() != TCP() )
+		return;
+
+	for ( const auto& child : TCP()->GetChildren() )
+		{
+		if ( child != this && ! child->IsAnalyzer("PIA_TCP") )
+			return;
+		}
+
+	TCP()->StopReassembly();
 	}
 
 void SSL_Analyzer::SendHandshake(uint16_t raw_tls_version, const u_char* begin, const u_char* end, bool orig)
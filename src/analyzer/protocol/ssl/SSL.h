@@ -32,9 +32,14 @@ public:
 		{ return new SSL_Analyzer(conn); }
 
 protected:
+	// Hands the connection back to the TCP layer once the handshake is
+	// done, if SSL::handshake_only allows it.
+	void CheckHandshakeOnly();
+
 	binpac::SSL::SSL_Conn* interp;
 	binpac::TLSHandshake::Handshake_Conn* handshake_interp;
 	bool had_gap;
+	bool handshake_only_checked;
 
 };
 
@@ -1,11 +1,72 @@
+#include <algorithm>
+#include <cstring>
+
 #include "ContentLine.h"
 #include "TCP.h"
 #include "Reporter.h"
 
 #include "events.bif.h"
 
+#include "3rdparty/doctest.h"
+
 using namespace analyzer::tcp;
 
+namespace {
+
+// True if any byte of the word is zero.
+inline bool has_zero_byte(uint64_t v)
+	{
+	return ((v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL) != 0;
+	}
+
+inline bool is_line_special(u_char c)
+	{
+	return c == '\r' || c == '\n' || c == '\0';
+	}
+
+// Returns the number of leading bytes of data (at most len) that are
+// not CR, LF or NUL. Scans eight bytes at a time, so that the bulk of a
+// line is skipped over without per-byte state checks.
+int ordinary_run(const u_char* data, int len)
+	{
+	const uint64_t cr = 0x0d0d0d0d0d0d0d0dULL;
+	const uint64_t lf = 0x0a0a0a0a0a0a0a0aULL;
+	int i = 0;
+
+	for ( ; i + 8 <= len; i += 8 )
+		{
+		uint64_t w;
+		memcpy(&w, data + i, sizeof(w));
+
+		if ( has_zero_byte(w) || has_zero_byte(w ^ cr) ||
+		     has_zero_byte(w ^ lf) )
+			break;
+		}
+
+	while ( i < len && ! is_line_special(data[i]) )
+		++i;
+
+	return i;
+	}
+
+}
+
+TEST_CASE("contentline ordinary_run")
+	{
+	const u_char* s = (const u_char*) "GET /index.html HTTP/1.1\r\nHost: x\r\n";
+	CHECK(ordinary_run(s, 0) == 0);
+	CHECK(ordinary_run(s, 5) == 5);
+	CHECK(ordinary_run(s, strlen((const char*) s)) == 24);
+	CHECK(ordinary_run(s + 24, 4) == 0);
+	CHECK(ordinary_run(s + 26, 10) == 7);
+
+	const u_char nul[] = "0123456789abcdef\0x";
+	CHECK(ordinary_run(nul, sizeof(nul) - 1) == 16);
+
+	const u_char lf[] = "abcdefghijklmnopqr\nstu";
+	CHECK(ordinary_run(lf, sizeof(lf) - 1) == 18);
+	}
+
 ContentLine_Analyzer::ContentLine_Analyzer(Connection* conn, bool orig, int max_line_length)
 : TCP_SupportAnalyzer("CONTENTLINE", conn, orig), max_line_length(max_line_length)
 	{
@@ -275,7 +336,21 @@ int ContentLine_Analyzer::DoDeliverOnce(int len, const u_char* data)
 			break;
 
 		default:
-			buf[offset++] = c;
+			{
+			// Copy the whole run of ordinary bytes at once, up
+			// to where the buffer or line length limit needs
+			// another look.
+			int room = std::min(buf_len, max_line_length) - offset;
+			int n = ordinary_run(data, std::min(len, room));
+
+			memcpy(buf + offset, data, n);
+			offset += n;
+
+			// The loop increment steps past the last byte.
+			len -= n - 1;
+			data += n - 1;
+			c = data[0];
+			}
 			break;
 		}
 
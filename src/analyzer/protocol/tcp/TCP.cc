@@ -9,6 +9,7 @@
 
 #include "IP.h"
 #include "Net.h"
+#include "iosource/Packet.h"
 #include "NetVar.h"
 #include "File.h"
 #include "Event.h"
@@ -276,6 +277,7 @@ bool TCP_Analyzer::ValidateChecksum(const struct tcphdr* tp,
 				TCP_Endpoint* endpoint, int len, int caplen)
 	{
 	if ( ! ignore_checksums && caplen >= len &&
+	     ! (current_pkt && current_pkt->l4_checksummed) &&
 	     ! endpoint->ValidChecksum(tp, len) )
 		{
 		Weird("bad_TCP_checksum");
@@ -1762,6 +1764,27 @@ bool TCP_Analyzer::HadGap(bool is_orig) const
 	return endp && endp->HadGap();
 	}
 
+bool TCP_Analyzer::StopReassembly()
+	{
+	TCP_Reassembler* r_orig = orig->contents_processor;
+	TCP_Reassembler* r_resp = resp->contents_processor;
+
+	if ( (r_orig && r_orig->RecordsContents()) ||
+	     (r_resp && r_resp->RecordsContents()) )
+		return false;
+
+	DBG_LOG(DBG_ANALYZER, "%s stopping reassembly",
+		fmt_analyzer(this).c_str());
+
+	if ( r_orig )
+		r_orig->StopDeliveries();
+
+	if ( r_resp )
+		r_resp->StopDeliveries();
+
+	return true;
+	}
+
 void TCP_Analyzer::AddChildPacketAnalyzer(analyzer::Analyzer* a)
 	{
 	DBG_LOG(DBG_ANALYZER, "%s added packet child %s",
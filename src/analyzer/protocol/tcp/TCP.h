@@ -44,6 +44,13 @@ public:
 
 	bool HadGap(bool orig) const;
 
+	// Stops reassembling both directions.  Packets keep updating the
+	// endpoints' sizes, sequence numbers and timestamps, but payload is
+	// neither buffered nor delivered to application analyzers anymore.
+	// Returns false, leaving reassembly alone, if the contents are also
+	// being recorded.
+	bool StopReassembly();
+
 	TCP_Endpoint* Orig() const	{ return orig; }
 	TCP_Endpoint* Resp() const	{ return resp; }
 	int OrigState() const	{ return orig->state; }
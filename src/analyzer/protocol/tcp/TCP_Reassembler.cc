@@ -654,6 +654,16 @@ void TCP_Reassembler::SkipToSeq(uint64_t seq)
 		}
 	}
 
+void TCP_Reassembler::StopDeliveries()
+	{
+	skip_deliveries = true;
+
+	// If we're called from within a delivery, BlockInserted() is still
+	// walking the block list; whatever remains gets trimmed by the acks.
+	if ( ! in_delivery )
+		ClearBlocks();
+	}
+
 int TCP_Reassembler::DataPending() const
 	{
 	// If we are skipping deliveries, the reassembler will not get called
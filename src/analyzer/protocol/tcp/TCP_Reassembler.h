@@ -60,6 +60,17 @@ public:
 	// Can be used to skip HTTP data for performance considerations.
 	void SkipToSeq(uint64_t seq);
 
+	// Stops buffering and delivering data altogether, discarding
+	// whatever is still waiting on a hole.  Subsequent segments only
+	// advance the endpoint's sequence space.  Safe to call from within
+	// a delivery.
+	void StopDeliveries();
+
+	// True if the raw contents are needed independently of the
+	// destination analyzer (contents file or tcp_contents events).
+	bool RecordsContents() const
+		{ return record_contents_file || deliver_tcp_contents; }
+
 	int DataSent(double t, uint64_t seq, int len, const u_char* data,
 		     analyzer::tcp::TCP_Flags flags, bool replaying=true);
 	void AckReceived(uint64_t seq);
@@ -5,6 +5,7 @@
 #include "zeek-config.h"
 
 #include "Net.h"
+#include "iosource/Packet.h"
 #include "NetVar.h"
 #include "analyzer/protocol/udp/UDP.h"
 #include "analyzer/Manager.h"
@@ -62,7 +63,8 @@ void UDP_Analyzer::DeliverPacket(int len, const u_char* data, bool is_orig,
 
 	int chksum = up->uh_sum;
 
-	auto validate_checksum = ! ignore_checksums && caplen >=len;
+	auto validate_checksum = ! ignore_checksums && caplen >=len &&
+	                         ! (current_pkt && current_pkt->l4_checksummed);
 	constexpr auto vxlan_len = 8;
 	constexpr auto eth_len = 14;
 
@@ -4,6 +4,7 @@
 
 #include "X509.h"
 #include "Event.h"
+#include "Var.h"
 
 #include "events.bif.h"
 #include "types.bif.h"
@@ -17,11 +18,26 @@
 #include <openssl/asn1.h>
 #include <openssl/opensslconf.h>
 #include <openssl/err.h>
+#include <openssl/sha.h>
 
 namespace file_analysis {
 std::map<Val*, X509_STORE*> X509::x509_stores;
+std::map<std::string, X509::CachedCertificate> X509::cert_cache;
+std::list<std::string> X509::cert_cache_lru;
+uint64_t X509::cert_cache_hits = 0;
+uint64_t X509::cert_cache_misses = 0;
 }
 
+static bro_uint_t certificate_cache_size()
+	{
+	static Val* size = 0;
+
+	if ( ! size )
+		size = internal_const_val("X509::certificate_cache_size");
+
+	return size->AsCount();
+	}
+
 using namespace file_analysis;
 
 file_analysis::X509::X509(RecordVal* args, file_analysis::File* file)
@@ -48,17 +64,44 @@ bool file_analysis::X509::EndOfFile()
 	// be rather straightforward...
 	const unsigned char* cert_char = reinterpret_cast<const unsigned char*>(cert_data.data());
 
-	::X509* ssl_cert = d2i_X509(NULL, &cert_char, cert_data.size());
-	if ( ! ssl_cert )
+	X509Val* cert_val = 0;
+	RecordVal* cert_record = 0;
+	std::string key;
+
+	if ( certificate_cache_size() > 0 )
 		{
-		reporter->Weird(GetFile(), "x509_cert_parse_error");
-		return false;
+		u_char digest[SHA256_DIGEST_LENGTH];
+		SHA256(cert_char, cert_data.size(), digest);
+		key.assign(reinterpret_cast<const char*>(digest), sizeof(digest));
+		if ( LookupCertificate(key, &cert_val, &cert_record) )
+			{
+			// ParseCertificate() reports malformed validity times
+			// for the file at hand, so check them for this one, too.
+			::X509* ssl_cert = cert_val->GetCertificate();
+			GetTimeFromAsn1(X509_get_notBefore(ssl_cert), GetFile(), reporter);
+			GetTimeFromAsn1(X509_get_notAfter(ssl_cert), GetFile(), reporter);
+			}
 		}
 
-	X509Val* cert_val = new X509Val(ssl_cert); // cert_val takes ownership of ssl_cert
+	if ( ! cert_val )
+		{
+		::X509* ssl_cert = d2i_X509(NULL, &cert_char, cert_data.size());
+		if ( ! ssl_cert )
+			{
+			reporter->Weird(GetFile(), "x509_cert_parse_error");
+			return false;
+			}
+
+		cert_val = new X509Val(ssl_cert); // cert_val takes ownership of ssl_cert
+
+		// parse basic information into record.
+		cert_record = ParseCertificate(cert_val, GetFile());
 
-	// parse basic information into record.
-	RecordVal* cert_record = ParseCertificate(cert_val, GetFile());
+		if ( ! key.empty() )
+			CacheCertificate(key, cert_val, cert_record);
+		}
+
+	::X509* ssl_cert = cert_val->GetCertificate();
 
 	// and send the record on to scriptland
 	mgr.QueueEvent(x509_certificate, {
@@ -258,6 +301,74 @@ void file_analysis::X509::FreeRootStore()
 		X509_STORE_free(e.second);
 	}
 
+bool file_analysis::X509::LookupCertificate(const std::string& key,
+                                            X509Val** cert_val,
+                                            RecordVal** cert_record)
+	{
+	auto i = cert_cache.find(key);
+
+	if ( i == cert_cache.end() )
+		{
+		++cert_cache_misses;
+		return false;
+		}
+
+	++cert_cache_hits;
+	cert_cache_lru.splice(cert_cache_lru.begin(), cert_cache_lru, i->second.lru_pos);
+
+	// The X509Val is immutable, so it can be shared. The record gets
+	// copied, as scripts are free to modify what they are handed.
+	*cert_val = i->second.cert_val;
+	(*cert_val)->Ref();
+	*cert_record = i->second.cert_record->Clone()->AsRecordVal();
+
+	return true;
+	}
+
+void file_analysis::X509::CacheCertificate(const std::string& key,
+                                           X509Val* cert_val,
+                                           RecordVal* cert_record)
+	{
+	while ( cert_cache.size() >= certificate_cache_size() )
+		{
+		auto i = cert_cache.find(cert_cache_lru.back());
+		Unref(i->second.cert_val);
+		Unref(i->second.cert_record);
+		cert_cache.erase(i);
+		cert_cache_lru.pop_back();
+		}
+
+	cert_cache_lru.push_front(key);
+
+	CachedCertificate c;
+	cert_val->Ref();
+	c.cert_val = cert_val;
+	c.cert_record = cert_record->Clone()->AsRecordVal();
+	c.lru_pos = cert_cache_lru.begin();
+	cert_cache[key] = c;
+	}
+
+void file_analysis::X509::FreeCertificateCache()
+	{
+	for ( const auto& e : cert_cache )
+		{
+		Unref(e.second.cert_val);
+		Unref(e.second.cert_record);
+		}
+
+	cert_cache.clear();
+	cert_cache_lru.clear();
+	}
+
+RecordVal* file_analysis::X509::GetCertificateCacheStats()
+	{
+	RecordVal* r = new RecordVal(BifType::Record::X509::CacheStats);
+	r->Assign(0, val_mgr->GetCount(cert_cache_hits));
+	r->Assign(1, val_mgr->GetCount(cert_cache_misses));
+	r->Assign(2, val_mgr->GetCount(cert_cache.size()));
+	return r;
+	}
+
 void file_analysis::X509::ParseBasicConstraints(X509_EXTENSION* ex)
 	{
 	assert(OBJ_obj2nid(X509_EXTENSION_get_object(ex)) == NID_basic_constraints);
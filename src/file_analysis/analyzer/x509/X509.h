@@ -3,6 +3,7 @@
 #pragma once
 
 #include <string>
+#include <list>
 #include <map>
 
 #include "OpaqueVal.h"
@@ -112,6 +113,17 @@ public:
 	 */
 	static void FreeRootStore();
 
+	/**
+	 * Releases all certificates held in the cache of parsed certificates.
+	 */
+	static void FreeCertificateCache();
+
+	/**
+	 * Returns the counters of the cache of parsed certificates as a
+	 * \c X509::CacheStats record value, passing ownership to the caller.
+	 */
+	static RecordVal* GetCertificateCacheStats();
+
 protected:
 	X509(RecordVal* args, File* file);
 
@@ -127,6 +139,24 @@ private:
 	static unsigned int KeyLength(EVP_PKEY *key);
 	/** X509 stores associated with global script-layer values */
 	static std::map<Val*, X509_STORE*> x509_stores;
+
+	// Cache of parsed certificates, keyed by the SHA256 of their DER
+	// encoding and bounded by X509::certificate_cache_size.
+	struct CachedCertificate {
+		X509Val* cert_val;
+		RecordVal* cert_record;
+		std::list<std::string>::iterator lru_pos;
+	};
+
+	static bool LookupCertificate(const std::string& key,
+	                              X509Val** cert_val, RecordVal** cert_record);
+	static void CacheCertificate(const std::string& key,
+	                             X509Val* cert_val, RecordVal* cert_record);
+
+	static std::map<std::string, CachedCertificate> cert_cache;
+	static std::list<std::string> cert_cache_lru; // most recently used first
+	static uint64_t cert_cache_hits;
+	static uint64_t cert_cache_misses;
 };
 
 /**
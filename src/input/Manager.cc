@@ -228,7 +228,7 @@ ReaderBackend* Manager::CreateBackend(ReaderFrontend* frontend, EnumVal* tag)
 	}
 
 // Create a new input reader object to be used at whomevers leisure later on.
-bool Manager::CreateStream(Stream* info, RecordVal* description)
+bool Manager::CreateStream(Stream* info, RecordVal* description, int num_idx_fields)
 	{
 	RecordType* rtype = description->Type()->AsRecordType();
 	if ( ! ( same_type(rtype, BifType::Record::Input::TableDescription, 0)
@@ -263,6 +263,7 @@ bool Manager::CreateStream(Stream* info, RecordVal* description)
 	ReaderBackend::ReaderInfo rinfo;
 	rinfo.source = copy_string(source.c_str());
 	rinfo.name = copy_string(name.c_str());
+	rinfo.num_idx_fields = num_idx_fields;
 
 	EnumVal* mode = description->Lookup("mode", true)->AsEnumVal();
 	switch ( mode->InternalInt() )
@@ -694,7 +695,7 @@ bool Manager::CreateTableStream(RecordVal* fval)
 
 	TableStream* stream = new TableStream();
 		{
-		bool res = CreateStream(stream, fval);
+		bool res = CreateStream(stream, fval, idxfields);
 		if ( ! res )
 			{
 			delete stream;
@@ -1093,20 +1094,22 @@ Val* Manager::ValueToIndexVal(const Stream* i, int num_fields, const RecordType
 	}
 
 
-void Manager::SendEntry(ReaderFrontend* reader, Value* *vals)
+void Manager::SendEntry(ReaderFrontend* reader, Value* *vals,
+                        HashKey* idxhash, hash_t valhash)
 	{
 	Stream *i = FindStream(reader);
 	if ( i == 0 )
 		{
 		reporter->InternalWarning("Unknown reader %s in SendEntry",
 		                          reader->Name());
+		delete idxhash;
 		return;
 		}
 
 	int readFields = 0;
 
 	if ( i->stream_type == TABLE_STREAM )
-		readFields = SendEntryTable(i, vals);
+		readFields = SendEntryTable(i, vals, idxhash, valhash);
 
 	else if ( i->stream_type == EVENT_STREAM )
 		{
@@ -1129,7 +1132,8 @@ void Manager::SendEntry(ReaderFrontend* reader, Value* *vals)
 	delete_value_ptr_array(vals, readFields);
 	}
 
-int Manager::SendEntryTable(Stream* i, const Value* const *vals)
+int Manager::SendEntryTable(Stream* i, const Value* const *vals,
+                            HashKey* idxhash, hash_t valhash)
 	{
 	bool updated = false;
 
@@ -1138,30 +1142,13 @@ int Manager::SendEntryTable(Stream* i, const Value* const *vals)
 	assert(i->stream_type == TABLE_STREAM);
 	TableStream* stream = (TableStream*) i;
 
-	HashKey* idxhash = HashValues(stream->num_idx_fields, vals);
-
+	// Both hashes have already been computed by the reader thread.
 	if ( idxhash == 0 )
 		{
 		Warning(i, "Could not hash line. Ignoring");
 		return stream->num_val_fields + stream->num_idx_fields;
 		}
 
-	hash_t valhash = 0;
-	if ( stream->num_val_fields > 0 )
-		{
-		HashKey* valhashkey = HashValues(stream->num_val_fields, vals+stream->num_idx_fields);
-		if ( valhashkey == 0 )
-			{
-			// empty line. index, but no values.
-			// hence we also have no hash value...
-			}
-		else
-			{
-			valhash = valhashkey->Hash();
-			delete(valhashkey);
-			}
-		}
-
 	InputHash *h = stream->lastDict->Lookup(idxhash);
 	if ( h != 0 )
 		{
@@ -2022,279 +2009,6 @@ RecordVal* Manager::ValueToRecordVal(const Stream* stream, const Value* const *v
 	return rec;
 	}
 
-// Count the length of the values used to create a correct length buffer for
-// hashing later
-int Manager::GetValueLength(const Value* val) const
-	{
-	assert( val->present ); // presence has to be checked elsewhere
-	int length = 0;
-
-	switch (val->type) {
-	case TYPE_BOOL:
-	case TYPE_INT:
-		length += sizeof(val->val.int_val);
-		break;
-
-	case TYPE_COUNT:
-	case TYPE_COUNTER:
-		length += sizeof(val->val.uint_val);
-		break;
-
-	case TYPE_PORT:
-		length += sizeof(val->val.port_val.port);
-		length += sizeof(val->val.port_val.proto);
-		break;
-
-	case TYPE_DOUBLE:
-	case TYPE_TIME:
-	case TYPE_INTERVAL:
-		length += sizeof(val->val.double_val);
-		break;
-
-	case TYPE_STRING:
-	case TYPE_ENUM:
-		{
-		length += val->val.string_val.length + 1;
-		break;
-		}
-
-	case TYPE_ADDR:
-		{
-		switch ( val->val.addr_val.family ) {
-		case IPv4:
-			length += sizeof(val->val.addr_val.in.in4);
-			break;
-		case IPv6:
-			length += sizeof(val->val.addr_val.in.in6);
-			break;
-		default:
-			assert(false);
-		}
-		}
-		break;
-
-	case TYPE_SUBNET:
-		{
-		switch ( val->val.subnet_val.prefix.family ) {
-		case IPv4:
-			length += sizeof(val->val.subnet_val.prefix.in.in4)+
-				  sizeof(val->val.subnet_val.length);
-			break;
-		case IPv6:
-			length += sizeof(val->val.subnet_val.prefix.in.in6)+
-				  sizeof(val->val.subnet_val.length);
-			break;
-		default:
-			assert(false);
-		}
-		}
-		break;
-
-	case TYPE_PATTERN:
-		{
-		length += strlen(val->val.pattern_text_val) + 1;
-		break;
-		}
-
-	case TYPE_TABLE:
-		{
-		for ( int i = 0; i < val->val.set_val.size; i++ )
-			length += GetValueLength(val->val.set_val.vals[i]);
-		break;
-		}
-
-	case TYPE_VECTOR:
-		{
-		int j = val->val.vector_val.size;
-		for ( int i = 0; i < j; i++ )
-			length += GetValueLength(val->val.vector_val.vals[i]);
-		break;
-		}
-
-	default:
-		reporter->InternalError("unsupported type %d for GetValueLength", val->type);
-	}
-
-	return length;
-
-}
-
-// Given a threading::value, copy the raw data bytes into *data and return how many bytes were copied.
-// Used for hashing the values for lookup in the bro table
-int Manager::CopyValue(char *data, const int startpos, const Value* val) const
-	{
-	assert( val->present ); // presence has to be checked elsewhere
-
-	switch ( val->type ) {
-	case TYPE_BOOL:
-	case TYPE_INT:
-		memcpy(data+startpos, (const void*) &(val->val.int_val), sizeof(val->val.int_val));
-		return sizeof(val->val.int_val);
-
-	case TYPE_COUNT:
-	case TYPE_COUNTER:
-		memcpy(data+startpos, (const void*) &(val->val.uint_val), sizeof(val->val.uint_val));
-		return sizeof(val->val.uint_val);
-
-	case TYPE_PORT:
-		{
-		int length = 0;
-		memcpy(data+startpos, (const void*) &(val->val.port_val.port),
-		       sizeof(val->val.port_val.port));
-		length += sizeof(val->val.port_val.port);
-		memcpy(data+startpos+length, (const void*) &(val->val.port_val.proto),
-		       sizeof(val->val.port_val.proto));
-		length += sizeof(val->val.port_val.proto);
-		return length;
-		}
-
-
-	case TYPE_DOUBLE:
-	case TYPE_TIME:
-	case TYPE_INTERVAL:
-		memcpy(data+startpos, (const void*) &(val->val.double_val),
-		       sizeof(val->val.double_val));
-		return sizeof(val->val.double_val);
-
-	case TYPE_STRING:
-	case TYPE_ENUM:
-		{
-		memcpy(data+startpos, val->val.string_val.data, val->val.string_val.length);
-		// Add a \0 to the end. To be able to hash zero-length
-		// strings and differentiate from !present.
-		memset(data + startpos + val->val.string_val.length, 0, 1);
-		return val->val.string_val.length + 1;
-		}
-
-	case TYPE_ADDR:
-		{
-		int length = 0;
-		switch ( val->val.addr_val.family ) {
-		case IPv4:
-			length = sizeof(val->val.addr_val.in.in4);
-			memcpy(data + startpos, (const char*) &(val->val.addr_val.in.in4), length);
-			break;
-
-		case IPv6:
-			length = sizeof(val->val.addr_val.in.in6);
-			memcpy(data + startpos, (const char*) &(val->val.addr_val.in.in6), length);
-			break;
-
-		default:
-			assert(false);
-		}
-
-		return length;
-		}
-
-	case TYPE_SUBNET:
-		{
-		int length = 0;
-		switch ( val->val.subnet_val.prefix.family ) {
-		case IPv4:
-			length = sizeof(val->val.addr_val.in.in4);
-			memcpy(data + startpos,
-			       (const char*) &(val->val.subnet_val.prefix.in.in4), length);
-			break;
-
-		case IPv6:
-			length = sizeof(val->val.addr_val.in.in6);
-			memcpy(data + startpos,
-			       (const char*) &(val->val.subnet_val.prefix.in.in6), length);
-			break;
-
-		default:
-			assert(false);
-		}
-
-		int lengthlength = sizeof(val->val.subnet_val.length);
-		memcpy(data + startpos + length ,
-		       (const char*) &(val->val.subnet_val.length), lengthlength);
-		length += lengthlength;
-
-		return length;
-		}
-
-	case TYPE_PATTERN:
-		{
-		// include null-terminator
-		int length = strlen(val->val.pattern_text_val) + 1;
-		memcpy(data + startpos, val->val.pattern_text_val, length);
-		return length;
-		}
-
-	case TYPE_TABLE:
-		{
-		int length = 0;
-		int j = val->val.set_val.size;
-		for ( int i = 0; i < j; i++ )
-			length += CopyValue(data, startpos+length, val->val.set_val.vals[i]);
-
-		return length;
-		}
-
-	case TYPE_VECTOR:
-		{
-		int length = 0;
-		int j = val->val.vector_val.size;
-		for ( int i = 0; i < j; i++ )
-			length += CopyValue(data, startpos+length, val->val.vector_val.vals[i]);
-
-		return length;
-		}
-
-	default:
-		reporter->InternalError("unsupported type %d for CopyValue", val->type);
-		return 0;
-	}
-
-	assert(false);
-	return 0;
-	}
-
-// Hash num_elements threading values and return the HashKey for them. At least one of the vals has to be ->present.
-HashKey* Manager::HashValues(const int num_elements, const Value* const *vals) const
-	{
-	int length = 0;
-
-	for ( int i = 0; i < num_elements; i++ )
-		{
-		const Value* val = vals[i];
-		if ( val->present )
-			length += GetValueLength(val);
-
-		// And in any case add 1 for the end-of-field-identifier.
-		length++;
-		}
-
-	assert ( length >= num_elements );
-
-	if ( length == num_elements )
-		return NULL;
-
-	int position = 0;
-	char *data = new char[length];
-
-	for ( int i = 0; i < num_elements; i++ )
-		{
-		const Value* val = vals[i];
-		if ( val->present )
-			position += CopyValue(data, position, val);
-
-		memset(data + position, 1, 1); // Add end-of-field-marker. Does not really matter which value it is,
-		                               // it just has to be... something.
-
-		position++;
-
-		}
-
-	HashKey *key = new HashKey(data, length);
-	delete [] data;
-
-	assert(position == length);
-	return key;
-	}
-
 // convert threading value to Bro value
 // have_error is a reference to a boolean which is set to true as soon as an error occured.
 // When have_error is set to true at the beginning of the function, it is assumed that
@@ -6,6 +6,7 @@
 
 #include "Component.h"
 #include "EventHandler.h"
+#include "Hash.h"
 #include "plugin/ComponentManager.h"
 #include "threading/SerialTypes.h"
 #include "Tag.h"
@@ -138,8 +139,12 @@ protected:
 
 	// For readers to write to input stream in indirect mode (manager is
 	// monitoring new/deleted values) Functions take ownership of
-	// threading::Value fields.
-	void SendEntry(ReaderFrontend* reader, threading::Value* *vals);
+	// threading::Value fields. For table streams, idxhash and valhash
+	// are the hashes of the index and value fields, computed by the
+	// reader thread; idxhash is null if the line couldn't be hashed.
+	// Takes ownership of idxhash.
+	void SendEntry(ReaderFrontend* reader, threading::Value* *vals,
+	               HashKey* idxhash = nullptr, hash_t valhash = 0);
 	void EndCurrentSend(ReaderFrontend* reader);
 
 	// Allows readers to directly send Bro events. The num_vals and vals
@@ -186,7 +191,7 @@ private:
 	// protected definitions are wrappers around this function.
 	bool RemoveStream(Stream* i);
 
-	bool CreateStream(Stream*, RecordVal* description);
+	bool CreateStream(Stream*, RecordVal* description, int num_idx_fields = 0);
 
 	// Check if the types of the error_ev event are correct. If table is
 	// true, check for tablestream type, otherwhise check for eventstream
@@ -194,7 +199,8 @@ private:
 	bool CheckErrorEventTypes(std::string stream_name, const Func* error_event, bool table) const;
 
 	// SendEntry implementation for Table stream.
-	int SendEntryTable(Stream* i, const threading::Value* const *vals);
+	int SendEntryTable(Stream* i, const threading::Value* const *vals,
+	                   HashKey* idxhash, hash_t valhash);
 
 	// Put implementation for Table stream.
 	int PutTable(Stream* i, const threading::Value* const *vals);
@@ -217,16 +223,6 @@ private:
 	// Call predicate function and return result.
 	bool CallPred(Func* pred_func, const int numvals, ...) const;
 
-	// Get a hashkey for a set of threading::Values.
-	HashKey* HashValues(const int num_elements, const threading::Value* const *vals) const;
-
-	// Get the memory used by a specific value.
-	int GetValueLength(const threading::Value* val) const;
-
-	// Copies the raw data in a specific threading::Value to position
-	// startpos.
-	int CopyValue(char *data, const int startpos, const threading::Value* val) const;
-
 	// Convert Threading::Value to an internal Bro Type (works also with
 	// Records).
 	Val* ValueToVal(const Stream* i, const threading::Value* val, BroType* request_type, bool& have_error) const;
@@ -3,6 +3,7 @@
 #include "ReaderBackend.h"
 #include "ReaderFrontend.h"
 #include "Manager.h"
+#include "Hash.h"
 
 using threading::Value;
 using threading::Field;
@@ -100,18 +101,21 @@ private:
 
 class SendEntryMessage : public threading::OutputMessage<ReaderFrontend> {
 public:
-	SendEntryMessage(ReaderFrontend* reader, Value* *val)
+	SendEntryMessage(ReaderFrontend* reader, Value* *val,
+			 HashKey* idxhash, hash_t valhash)
 		: threading::OutputMessage<ReaderFrontend>("SendEntry", reader),
-		val(val) { }
+		val(val), idxhash(idxhash), valhash(valhash) { }
 
 	virtual bool Process()
 		{
-		input_mgr->SendEntry(Object(), val);
+		input_mgr->SendEntry(Object(), val, idxhash, valhash);
 		return true;
 		}
 
 private:
 	Value* *val;
+	HashKey* idxhash;
+	hash_t valhash;
 };
 
 class EndCurrentSendMessage : public threading::OutputMessage<ReaderFrontend> {
@@ -246,7 +250,32 @@ void ReaderBackend::EndOfData()
 
 void ReaderBackend::SendEntry(Value* *vals)
 	{
-	SendOut(new SendEntryMessage(frontend, vals));
+	HashKey* idxhash = nullptr;
+	hash_t valhash = 0;
+
+	// For table streams, hash the entry here so that a full refresh
+	// doesn't spend main-thread time on it.
+	if ( info->num_idx_fields > 0 )
+		{
+		int num_idx_fields = info->num_idx_fields;
+		int num_val_fields = num_fields - num_idx_fields;
+
+		idxhash = HashValues(num_idx_fields, vals);
+
+		if ( idxhash && num_val_fields > 0 )
+			{
+			HashKey* valhashkey = HashValues(num_val_fields, vals + num_idx_fields);
+
+			// An empty value (index, but no values) has no hash.
+			if ( valhashkey )
+				{
+				valhash = valhashkey->Hash();
+				delete valhashkey;
+				}
+			}
+		}
+
+	SendOut(new SendEntryMessage(frontend, vals, idxhash, valhash));
 	}
 
 bool ReaderBackend::Init(const int arg_num_fields,
@@ -369,4 +398,277 @@ void ReaderBackend::Error(const char* msg)
 	DisableFrontend();
 	}
 
+// Count the length of the values used to create a correct length buffer for
+// hashing later
+int ReaderBackend::GetValueLength(const Value* val)
+	{
+	assert( val->present ); // presence has to be checked elsewhere
+	int length = 0;
+
+	switch (val->type) {
+	case TYPE_BOOL:
+	case TYPE_INT:
+		length += sizeof(val->val.int_val);
+		break;
+
+	case TYPE_COUNT:
+	case TYPE_COUNTER:
+		length += sizeof(val->val.uint_val);
+		break;
+
+	case TYPE_PORT:
+		length += sizeof(val->val.port_val.port);
+		length += sizeof(val->val.port_val.proto);
+		break;
+
+	case TYPE_DOUBLE:
+	case TYPE_TIME:
+	case TYPE_INTERVAL:
+		length += sizeof(val->val.double_val);
+		break;
+
+	case TYPE_STRING:
+	case TYPE_ENUM:
+		{
+		length += val->val.string_val.length + 1;
+		break;
+		}
+
+	case TYPE_ADDR:
+		{
+		switch ( val->val.addr_val.family ) {
+		case IPv4:
+			length += sizeof(val->val.addr_val.in.in4);
+			break;
+		case IPv6:
+			length += sizeof(val->val.addr_val.in.in6);
+			break;
+		default:
+			assert(false);
+		}
+		}
+		break;
+
+	case TYPE_SUBNET:
+		{
+		switch ( val->val.subnet_val.prefix.family ) {
+		case IPv4:
+			length += sizeof(val->val.subnet_val.prefix.in.in4)+
+				  sizeof(val->val.subnet_val.length);
+			break;
+		case IPv6:
+			length += sizeof(val->val.subnet_val.prefix.in.in6)+
+				  sizeof(val->val.subnet_val.length);
+			break;
+		default:
+			assert(false);
+		}
+		}
+		break;
+
+	case TYPE_PATTERN:
+		{
+		length += strlen(val->val.pattern_text_val) + 1;
+		break;
+		}
+
+	case TYPE_TABLE:
+		{
+		for ( int i = 0; i < val->val.set_val.size; i++ )
+			length += GetValueLength(val->val.set_val.vals[i]);
+		break;
+		}
+
+	case TYPE_VECTOR:
+		{
+		int j = val->val.vector_val.size;
+		for ( int i = 0; i < j; i++ )
+			length += GetValueLength(val->val.vector_val.vals[i]);
+		break;
+		}
+
+	default:
+		InternalError(Fmt("unsupported type %d for GetValueLength", val->type));
+	}
+
+	return length;
+
+}
+
+// Given a threading::value, copy the raw data bytes into *data and return how many bytes were copied.
+// Used for hashing the values for lookup in the bro table
+int ReaderBackend::CopyValue(char *data, const int startpos, const Value* val)
+	{
+	assert( val->present ); // presence has to be checked elsewhere
+
+	switch ( val->type ) {
+	case TYPE_BOOL:
+	case TYPE_INT:
+		memcpy(data+startpos, (const void*) &(val->val.int_val), sizeof(val->val.int_val));
+		return sizeof(val->val.int_val);
+
+	case TYPE_COUNT:
+	case TYPE_COUNTER:
+		memcpy(data+startpos, (const void*) &(val->val.uint_val), sizeof(val->val.uint_val));
+		return sizeof(val->val.uint_val);
+
+	case TYPE_PORT:
+		{
+		int length = 0;
+		memcpy(data+startpos, (const void*) &(val->val.port_val.port),
+		       sizeof(val->val.port_val.port));
+		length += sizeof(val->val.port_val.port);
+		memcpy(data+startpos+length, (const void*) &(val->val.port_val.proto),
+		       sizeof(val->val.port_val.proto));
+		length += sizeof(val->val.port_val.proto);
+		return length;
+		}
+
+
+	case TYPE_DOUBLE:
+	case TYPE_TIME:
+	case TYPE_INTERVAL:
+		memcpy(data+startpos, (const void*) &(val->val.double_val),
+		       sizeof(val->val.double_val));
+		return sizeof(val->val.double_val);
+
+	case TYPE_STRING:
+	case TYPE_ENUM:
+		{
+		memcpy(data+startpos, val->val.string_val.data, val->val.string_val.length);
+		// Add a \0 to the end. To be able to hash zero-length
+		// strings and differentiate from !present.
+		memset(data + startpos + val->val.string_val.length, 0, 1);
+		return val->val.string_val.length + 1;
+		}
+
+	case TYPE_ADDR:
+		{
+		int length = 0;
+		switch ( val->val.addr_val.family ) {
+		case IPv4:
+			length = sizeof(val->val.addr_val.in.in4);
+			memcpy(data + startpos, (const char*) &(val->val.addr_val.in.in4), length);
+			break;
+
+		case IPv6:
+			length = sizeof(val->val.addr_val.in.in6);
+			memcpy(data + startpos, (const char*) &(val->val.addr_val.in.in6), length);
+			break;
+
+		default:
+			assert(false);
+		}
+
+		return length;
+		}
+
+	case TYPE_SUBNET:
+		{
+		int length = 0;
+		switch ( val->val.subnet_val.prefix.family ) {
+		case IPv4:
+			length = sizeof(val->val.addr_val.in.in4);
+			memcpy(data + startpos,
+			       (const char*) &(val->val.subnet_val.prefix.in.in4), length);
+			break;
+
+		case IPv6:
+			length = sizeof(val->val.addr_val.in.in6);
+			memcpy(data + startpos,
+			       (const char*) &(val->val.subnet_val.prefix.in.in6), length);
+			break;
+
+		default:
+			assert(false);
+		}
+
+		int lengthlength = sizeof(val->val.subnet_val.length);
+		memcpy(data + startpos + length ,
+		       (const char*) &(val->val.subnet_val.length), lengthlength);
+		length += lengthlength;
+
+		return length;
+		}
+
+	case TYPE_PATTERN:
+		{
+		// include null-terminator
+		int length = strlen(val->val.pattern_text_val) + 1;
+		memcpy(data + startpos, val->val.pattern_text_val, length);
+		return length;
+		}
+
+	case TYPE_TABLE:
+		{
+		int length = 0;
+		int j = val->val.set_val.size;
+		for ( int i = 0; i < j; i++ )
+			length += CopyValue(data, startpos+length, val->val.set_val.vals[i]);
+
+		return length;
+		}
+
+	case TYPE_VECTOR:
+		{
+		int length = 0;
+		int j = val->val.vector_val.size;
+		for ( int i = 0; i < j; i++ )
+			length += CopyValue(data, startpos+length, val->val.vector_val.vals[i]);
+
+		return length;
+		}
+
+	default:
+		InternalError(Fmt("unsupported type %d for CopyValue", val->type));
+		return 0;
+	}
+
+	assert(false);
+	return 0;
+	}
+
+// Hash num_elements threading values and return the HashKey for them. At least one of the vals has to be ->present.
+HashKey* ReaderBackend::HashValues(const int num_elements, const Value* const *vals)
+	{
+	int length = 0;
+
+	for ( int i = 0; i < num_elements; i++ )
+		{
+		const Value* val = vals[i];
+		if ( val->present )
+			length += GetValueLength(val);
+
+		// And in any case add 1 for the end-of-field-identifier.
+		length++;
+		}
+
+	assert ( length >= num_elements );
+
+	if ( length == num_elements )
+		return NULL;
+
+	int position = 0;
+	char *data = new char[length];
+
+	for ( int i = 0; i < num_elements; i++ )
+		{
+		const Value* val = vals[i];
+		if ( val->present )
+			position += CopyValue(data, position, val);
+
+		memset(data + position, 1, 1); // Add end-of-field-marker. Does not really matter which value it is,
+		                               // it just has to be... something.
+
+		position++;
+
+		}
+
+	HashKey *key = new HashKey(data, length);
+	delete [] data;
+
+	assert(position == length);
+	return key;
+	}
+
 }
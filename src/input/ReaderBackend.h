@@ -9,6 +9,8 @@
 
 #include "Component.h"
 
+class HashKey;
+
 namespace input {
 
 /**
@@ -102,11 +104,20 @@ public:
 		 */
 		ReaderMode mode;
 
+		/**
+		 * For table streams, the number of leading fields that make
+		 * up the table index; zero for other streams. Readers don't
+		 * need to look at this: SendEntry() uses it to hash entries
+		 * in the reader thread rather than in the main thread.
+		 */
+		int num_idx_fields;
+
 		ReaderInfo()
 			{
 			source = 0;
 			name = 0;
 			mode = MODE_NONE;
+			num_idx_fields = 0;
 			}
 
 		ReaderInfo(const ReaderInfo& other)
@@ -114,6 +125,7 @@ public:
 			source = other.source ? copy_string(other.source) : 0;
 			name = other.name ? copy_string(other.name) : 0;
 			mode = other.mode;
+			num_idx_fields = other.num_idx_fields;
 
 			for ( config_map::const_iterator i = other.config.begin(); i != other.config.end(); i++ )
 				config.insert(std::make_pair(copy_string(i->first), copy_string(i->second)));
@@ -362,6 +374,17 @@ protected:
 	void EndCurrentSend();
 
 private:
+	// Get a hashkey for a set of threading::Values. Returns null if
+	// none of them is present.
+	HashKey* HashValues(const int num_elements, const threading::Value* const *vals);
+
+	// Get the memory used by a specific value.
+	int GetValueLength(const threading::Value* val);
+
+	// Copies the raw data in a specific threading::Value to position
+	// startpos.
+	int CopyValue(char *data, const int startpos, const threading::Value* val);
+
 	// Frontend that instantiated us. This object must not be accessed
 	// from this class, it's running in a different thread!
 	ReaderFrontend* frontend;
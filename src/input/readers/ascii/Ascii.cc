@@ -4,6 +4,8 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -52,14 +54,21 @@ Ascii::Ascii(ReaderFrontend *frontend) : ReaderBackend(frontend)
 	ino = 0;
 	fail_on_file_problem = false;
 	fail_on_invalid_lines = false;
+	use_mmap = false;
+	mapped = nullptr;
+	mapped_len = 0;
+	mapped_pos = 0;
+	mapped_open = false;
 	}
 
 Ascii::~Ascii()
 	{
+	CloseFile();
 	}
 
 void Ascii::DoClose()
 	{
+	CloseFile();
 	}
 
 bool Ascii::DoInit(const ReaderInfo& info, int num_fields, const Field* const* fields)
@@ -84,6 +93,8 @@ bool Ascii::DoInit(const ReaderInfo& info, int num_fields, const Field* const* f
 	path_prefix.assign((const char*) BifConst::InputAscii::path_prefix->Bytes(),
 	                   BifConst::InputAscii::path_prefix->Len());
 
+	use_mmap = BifConst::InputAscii::use_mmap;
+
 	// Set per-filter configuration options.
 	for ( ReaderInfo::config_map::const_iterator i = info.config.begin(); i != info.config.end(); i++ )
 		{
@@ -104,8 +115,15 @@ bool Ascii::DoInit(const ReaderInfo& info, int num_fields, const Field* const* f
 
 		else if ( strcmp(i->first, "fail_on_file_problem") == 0 )
 			fail_on_file_problem = (strncmp(i->second, "T", 1) == 0);
+
+		else if ( strcmp(i->first, "use_mmap") == 0 )
+			use_mmap = (strncmp(i->second, "T", 1) == 0);
 		}
 
+	// Streaming needs to pick up appended data, which a mapping won't.
+	if ( Info().mode == MODE_STREAM )
+		use_mmap = false;
+
 	if ( separator.size() != 1 )
 		Error("separator length has to be 1. Separator will be truncated.");
 
@@ -121,7 +139,7 @@ bool Ascii::DoInit(const ReaderInfo& info, int num_fields, const Field* const* f
 
 bool Ascii::OpenFile()
 	{
-	if ( file.is_open() )
+	if ( IsOpen() )
 		return true;
 
 	// Handle path-prefixing. See similar logic in Binary::DoInit().
@@ -140,9 +158,12 @@ bool Ascii::OpenFile()
 		fname = path + "/" + fname;
 		}
 
-	file.open(fname);
+	if ( use_mmap )
+		MapFile();
+	else
+		file.open(fname);
 
-	if ( ! file.is_open() )
+	if ( ! IsOpen() )
 		{
 		FailWarn(fail_on_file_problem, Fmt("Init: cannot open %s", fname.c_str()), true);
 
@@ -153,7 +174,7 @@ bool Ascii::OpenFile()
 		{
 		FailWarn(fail_on_file_problem, Fmt("Init: cannot open %s; problem reading file header", fname.c_str()), true);
 
-		file.close();
+		CloseFile();
 		return ! fail_on_file_problem;
 		}
 
@@ -161,26 +182,83 @@ bool Ascii::OpenFile()
 	return true;
 	}
 
+bool Ascii::MapFile()
+	{
+	int fd = open(fname.c_str(), O_RDONLY);
+
+	if ( fd < 0 )
+		return false;
+
+	struct stat sb;
+
+	if ( fstat(fd, &sb) < 0 )
+		{
+		close(fd);
+		return false;
+		}
+
+	mapped = nullptr;
+	mapped_len = sb.st_size;
+	mapped_pos = 0;
+
+	// mmap() rejects empty mappings; an empty file simply has no lines.
+	if ( mapped_len > 0 )
+		{
+		void* m = mmap(0, mapped_len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if ( m == MAP_FAILED )
+			{
+			close(fd);
+			mapped_len = 0;
+			return false;
+			}
+
+		madvise(m, mapped_len, MADV_SEQUENTIAL);
+		mapped = static_cast<const char*>(m);
+		}
+
+	// The mapping stays valid after closing the descriptor.
+	close(fd);
+	mapped_open = true;
+	return true;
+	}
+
+void Ascii::CloseFile()
+	{
+	if ( mapped_open )
+		{
+		if ( mapped )
+			munmap(const_cast<char*>(mapped), mapped_len);
+
+		mapped = nullptr;
+		mapped_len = mapped_pos = 0;
+		mapped_open = false;
+		}
+
+	if ( file.is_open() )
+		file.close();
+	}
+
 bool Ascii::ReadHeader(bool useCached)
 	{
 	// try to read the header line...
-	string line;
 	map<string, uint32_t> ifields;
 
 	if ( ! useCached )
 		{
-		if ( ! GetLine(line) )
+		std::string_view l;
+
+		if ( ! GetLine(l) )
 			{
 			FailWarn(fail_on_file_problem, Fmt("Could not read input data file %s; first line could not be read",
 							   fname.c_str()), true);
 			return false;
 			}
 
-		headerline = line;
+		headerline = string(l);
 		}
 
-	else
-		line = headerline;
+	const string& line = headerline;
 
 	// construct list of field names.
 	istringstream splitstream(line);
@@ -243,22 +321,22 @@ bool Ascii::ReadHeader(bool useCached)
 	return true;
 	}
 
-bool Ascii::GetLine(string& str)
+bool Ascii::GetLine(std::string_view& str)
 	{
-	while ( getline(file, str) )
+	while ( ReadLine(str) )
 		{
 		if ( ! str.size() )
 			continue;
 
 		if ( str.back() == '\r' ) // deal with \r\n by removing \r
-			str.pop_back();
+			str.remove_suffix(1);
 
-		if ( str[0] != '#' )
+		if ( str.empty() || str[0] != '#' )
 			return true;
 
 		if ( ( str.length() > 8 ) && ( str.compare(0,7, "#fields") == 0 ) && ( str[7] == separator[0] ) )
 			{
-			str = str.substr(8);
+			str.remove_prefix(8);
 			return true;
 			}
 		}
@@ -266,6 +344,32 @@ bool Ascii::GetLine(string& str)
 	return false;
 	}
 
+// Returns the next raw line, without its newline. The view remains valid
+// until the next call.
+bool Ascii::ReadLine(std::string_view& str)
+	{
+	if ( ! mapped_open )
+		{
+		if ( ! getline(file, linebuf) )
+			return false;
+
+		str = linebuf;
+		return true;
+		}
+
+	if ( mapped_pos >= mapped_len )
+		return false;
+
+	const char* start = mapped + mapped_pos;
+	size_t left = mapped_len - mapped_pos;
+	const char* nl = static_cast<const char*>(memchr(start, '\n', left));
+	size_t len = nl ? nl - start : left;
+
+	str = std::string_view(start, len);
+	mapped_pos += nl ? len + 1 : len;
+	return true;
+	}
+
 // read the entire file and send appropriate thingies back to InputMgr
 bool Ascii::DoUpdate()
 	{
@@ -281,7 +385,7 @@ bool Ascii::DoUpdate()
 				{
 				FailWarn(fail_on_file_problem, Fmt("Could not get stat for %s", fname.c_str()), true);
 
-				file.close();
+				CloseFile();
 				return ! fail_on_file_problem;
 				}
 
@@ -305,7 +409,7 @@ bool Ascii::DoUpdate()
 			{
 			// dirty, fix me. (well, apparently after trying seeking, etc
 			// - this is not that bad)
-			if ( file.is_open() )
+			if ( IsOpen() )
 				{
 				if ( Info().mode == MODE_STREAM )
 					{
@@ -318,7 +422,7 @@ bool Ascii::DoUpdate()
 					break;
 					}
 
-				file.close();
+				CloseFile();
 				}
 
 			OpenFile();
@@ -331,29 +435,35 @@ bool Ascii::DoUpdate()
 
 		}
 
-	string line;
+	std::string_view line;
 
-	file.sync();
+	if ( file.is_open() )
+		file.sync();
 
 	while ( GetLine(line) )
 		{
-		// split on tabs
+		// split on tabs. A trailing separator doesn't start another field.
 		bool error = false;
-		istringstream splitstream(line);
+		const char* p = line.data();
+		const char* end = p + line.size();
+
+		linefields.clear();
 
-		map<int, string> stringfields;
-		int pos = 0;
-		while ( splitstream )
+		while ( p < end )
 			{
-			string s;
-			if ( ! getline(splitstream, s, separator[0]) )
+			const char* sep = static_cast<const char*>(memchr(p, separator[0], end - p));
+
+			if ( ! sep )
+				{
+				linefields.emplace_back(p, end - p);
 				break;
+				}
 
-			stringfields[pos] = s;
-			pos++;
+			linefields.emplace_back(p, sep - p);
+			p = sep + 1;
 			}
 
-		pos--; // for easy comparisons of max element.
+		int pos = linefields.size() - 1; // for easy comparisons of max element.
 
 		Value** fields = new Value*[NumFields()];
 
@@ -376,7 +486,7 @@ bool Ascii::DoUpdate()
 			if ( (*fit).position > pos || (*fit).secondary_position > pos )
 				{
 				FailWarn(fail_on_invalid_lines, Fmt("Not enough fields in line '%s' of %s. Found %d fields, want positions %d and %d",
-				                                    line.c_str(), fname.c_str(), pos, (*fit).position, (*fit).secondary_position));
+				                                    string(line).c_str(), fname.c_str(), pos, (*fit).position, (*fit).secondary_position));
 
 				if ( fail_on_invalid_lines )
 					{
@@ -394,11 +504,11 @@ bool Ascii::DoUpdate()
 					}
 				}
 
-			Value* val = formatter->ParseValue(stringfields[(*fit).position], (*fit).name, (*fit).type, (*fit).subtype);
+			Value* val = formatter->ParseValue(string(linefields[(*fit).position]), (*fit).name, (*fit).type, (*fit).subtype);
 
 			if ( val == 0 )
 				{
-				Warning(Fmt("Could not convert line '%s' of %s to Val. Ignoring line.", line.c_str(), fname.c_str()));
+				Warning(Fmt("Could not convert line '%s' of %s to Val. Ignoring line.", string(line).c_str(), fname.c_str()));
 				error = true;
 				break;
 				}
@@ -409,7 +519,7 @@ bool Ascii::DoUpdate()
 				assert(val->type == TYPE_PORT );
 				//	Error(Fmt("Got type %d != PORT with secondary position!", val->type));
 
-				val->val.port_val.proto = formatter->ParseProto(stringfields[(*fit).secondary_position]);
+				val->val.port_val.proto = formatter->ParseProto(string(linefields[(*fit).secondary_position]));
 				}
 
 			fields[fpos] = val;
@@ -6,6 +6,7 @@
 #include <vector>
 #include <fstream>
 #include <memory>
+#include <string_view>
 #include <sys/types.h>
 
 #include "input/ReaderBackend.h"
@@ -54,10 +55,28 @@ protected:
 
 private:
 	bool ReadHeader(bool useCached);
-	bool GetLine(string& str);
+	bool GetLine(std::string_view& str);
+	bool ReadLine(std::string_view& str);
 	bool OpenFile();
+	bool MapFile();
+	void CloseFile();
+	bool IsOpen() const	{ return mapped_open || file.is_open(); }
 
 	ifstream file;
+
+	// The line most recently read from file.
+	string linebuf;
+
+	// When use_mmap is set, files are read through this mapping
+	// instead of through file.
+	const char* mapped;
+	size_t mapped_len;
+	size_t mapped_pos;
+	bool mapped_open;
+
+	// Views of the fields of the current line; they point into either
+	// the mapping or linebuf.
+	vector<std::string_view> linefields;
 	time_t mtime;
 	ino_t ino;
 
@@ -80,6 +99,7 @@ private:
 	bool fail_on_invalid_lines;
 	bool fail_on_file_problem;
 	string path_prefix;
+	bool use_mmap;
 
 	std::unique_ptr<threading::formatter::Formatter> formatter;
 };
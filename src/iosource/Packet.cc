@@ -47,6 +47,7 @@ void Packet::Init(int arg_link_type, pkt_timeval *arg_ts, uint32_t arg_caplen,
 	eth_type = 0;
 	vlan = 0;
 	inner_vlan = 0;
+	l4_checksummed = false;
 	l2_src = 0;
 	l2_dst = 0;
 
@@ -199,6 +199,15 @@ public:
 	 */
 	uint32_t inner_vlan;
 
+	/**
+	 * True if the transport-layer checksum has already been verified
+	 * before the packet reached us, typically by the NIC.  Packet
+	 * sources that learn this per packet (e.g., from the status bits
+	 * of a capture ring) set it after \a Init(); the TCP, UDP and ICMP
+	 * analyzers then skip verifying the checksum themselves.
+	 */
+	bool l4_checksummed;
+
 private:
 	// Calculate layer 2 attributes. Sets
 	void ProcessLayer2();
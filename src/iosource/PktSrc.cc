@@ -23,6 +23,7 @@ PktSrc::Properties::Properties()
 	link_type = -1;
 	netmask = NETMASK_UNKNOWN;
 	is_live = false;
+	l4_checksummed = false;
 	}
 
 PktSrc::PktSrc()
@@ -199,6 +200,9 @@ void PktSrc::Process()
 	if ( ! ExtractNextPacketInternal() )
 		return;
 
+	if ( props.l4_checksummed )
+		current_packet.l4_checksummed = true;
+
 	if ( current_packet.Layer2Valid() )
 		{
 		if ( pseudo_realtime )
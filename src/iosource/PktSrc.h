@@ -258,6 +258,14 @@ protected:
 		 */
 		bool is_live;
 
+		/**
+		 * True if all packets from this source have had their
+		 * transport-layer checksums verified already, e.g. because
+		 * the NIC drops packets with bad checksums.  Sources that can
+		 * only tell per packet set Packet::l4_checksummed instead.
+		 */
+		bool l4_checksummed;
+
 		Properties();
 	};
 
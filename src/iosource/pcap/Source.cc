@@ -168,6 +168,7 @@ void PcapSource::OpenLive()
 
 	props.link_type = pcap_datalink(pd);
 	props.is_live = true;
+	props.l4_checksummed = BifConst::Pcap::l4_checksums_verified;
 
 	Opened(props);
 	}
@@ -2,14 +2,18 @@
 
 #include "BloomFilter.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <limits>
 
 #include <broker/data.hh>
 #include <broker/error.hh>
+#include <openssl/sha.h>
 
 #include "CounterVector.h"
 
+#include "../digest.h"
 #include "../util.h"
 #include "../Reporter.h"
 
@@ -70,6 +74,18 @@ std::unique_ptr<BloomFilter> BloomFilter::Unserialize(const broker::data& data)
 	case Counting:
 		bf = std::unique_ptr<BloomFilter>(new CountingBloomFilter());
 		break;
+
+	case Blocked:
+		// Probe() needs two digests, one for the block and one for
+		// the bits within it.
+		if ( hasher_->K() < 2 )
+			return nullptr;
+
+		bf = std::unique_ptr<BloomFilter>(new BlockedBloomFilter());
+		break;
+
+	default:
+		return nullptr;
 	}
 
 	if ( ! bf->DoUnserialize((*v)[2]) )
@@ -300,3 +316,172 @@ bool CountingBloomFilter::DoUnserialize(const broker::data& data)
 	cells = c.release();
 	return true;
 	}
+
+BlockedBloomFilter::BlockedBloomFilter()
+	{
+	k = 0;
+	}
+
+BlockedBloomFilter::BlockedBloomFilter(const Hasher* hasher, size_t cells,
+                                       size_t arg_k)
+	: BloomFilter(hasher)
+	{
+	size_t blocks = (cells + BLOCK_BITS - 1) / BLOCK_BITS;
+
+	if ( blocks == 0 )
+		blocks = 1;
+
+	k = std::min(arg_k, static_cast<size_t>(BLOCK_BITS));
+	words.resize(blocks * BLOCK_WORDS, 0);
+	}
+
+BlockedBloomFilter::~BlockedBloomFilter()
+	{
+	}
+
+size_t BlockedBloomFilter::Probe(const HashKey* key, uint64_t* mask) const
+	{
+	Hasher::digest_vector h = hasher->Hash(key);
+	assert(h.size() >= 2);
+
+	size_t blocks = words.size() / BLOCK_WORDS;
+	size_t block = h[0] % blocks;
+
+	// Double hashing within the block; an odd stride visits k distinct
+	// bits as long as k <= BLOCK_BITS.
+	uint64_t pos = h[1] % BLOCK_BITS;
+	uint64_t stride = ((h[1] >> 32) % BLOCK_BITS) | 1;
+
+	for ( size_t i = 0; i < BLOCK_WORDS; ++i )
+		mask[i] = 0;
+
+	for ( size_t i = 0; i < k; ++i )
+		{
+		mask[pos / 64] |= uint64_t(1) << (pos % 64);
+		pos = (pos + stride) % BLOCK_BITS;
+		}
+
+	return block * BLOCK_WORDS;
+	}
+
+void BlockedBloomFilter::Add(const HashKey* key)
+	{
+	uint64_t mask[BLOCK_WORDS];
+	uint64_t* block = &words[Probe(key, mask)];
+
+	for ( size_t i = 0; i < BLOCK_WORDS; ++i )
+		block[i] |= mask[i];
+	}
+
+size_t BlockedBloomFilter::Count(const HashKey* key) const
+	{
+	uint64_t mask[BLOCK_WORDS];
+	const uint64_t* block = &words[Probe(key, mask)];
+
+	// No early exit, so that the compiler can vectorize the whole block.
+	uint64_t missing = 0;
+
+	for ( size_t i = 0; i < BLOCK_WORDS; ++i )
+		missing |= mask[i] & ~block[i];
+
+	return missing == 0 ? 1 : 0;
+	}
+
+bool BlockedBloomFilter::Empty() const
+	{
+	for ( auto w : words )
+		if ( w )
+			return false;
+
+	return true;
+	}
+
+void BlockedBloomFilter::Clear()
+	{
+	std::fill(words.begin(), words.end(), 0);
+	}
+
+bool BlockedBloomFilter::Merge(const BloomFilter* other)
+	{
+	if ( typeid(*this) != typeid(*other) )
+		return false;
+
+	const BlockedBloomFilter* o = static_cast<const BlockedBloomFilter*>(other);
+
+	if ( ! hasher->Equals(o->hasher) )
+		{
+		reporter->Error("incompatible hashers in BlockedBloomFilter merge");
+		return false;
+		}
+
+	else if ( words.size() != o->words.size() || k != o->k )
+		{
+		reporter->Error("different parameters in BlockedBloomFilter merge");
+		return false;
+		}
+
+	for ( size_t i = 0; i < words.size(); ++i )
+		words[i] |= o->words[i];
+
+	return true;
+	}
+
+BlockedBloomFilter* BlockedBloomFilter::Clone() const
+	{
+	BlockedBloomFilter* copy = new BlockedBloomFilter();
+
+	copy->hasher = hasher->Clone();
+	copy->k = k;
+	copy->words = words;
+
+	return copy;
+	}
+
+std::string BlockedBloomFilter::InternalState() const
+	{
+	u_char buf[SHA256_DIGEST_LENGTH];
+	uint64_t digest;
+	EVP_MD_CTX* ctx = hash_init(Hash_SHA256);
+	hash_update(ctx, words.data(), words.size() * sizeof(uint64_t));
+	hash_final(ctx, buf);
+	memcpy(&digest, buf, sizeof(digest));
+	return fmt("%" PRIu64, digest);
+	}
+
+broker::expected<broker::data> BlockedBloomFilter::DoSerialize() const
+	{
+	broker::vector v = {static_cast<uint64_t>(k)};
+	v.reserve(words.size() + 1);
+
+	for ( auto w : words )
+		v.emplace_back(w);
+
+	return {std::move(v)};
+	}
+
+bool BlockedBloomFilter::DoUnserialize(const broker::data& data)
+	{
+	auto v = caf::get_if<broker::vector>(&data);
+
+	if ( ! (v && v->size() > 1 && (v->size() - 1) % BLOCK_WORDS == 0) )
+		return false;
+
+	auto arg_k = caf::get_if<uint64_t>(&(*v)[0]);
+	if ( ! arg_k || *arg_k == 0 || *arg_k > BLOCK_BITS )
+		return false;
+
+	k = *arg_k;
+	words.clear();
+	words.reserve(v->size() - 1);
+
+	for ( size_t i = 1; i < v->size(); ++i )
+		{
+		auto w = caf::get_if<uint64_t>(&(*v)[i]);
+		if ( ! w )
+			return false;
+
+		words.push_back(*w);
+		}
+
+	return true;
+	}
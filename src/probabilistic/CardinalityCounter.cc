@@ -4,14 +4,45 @@
 
 #include <math.h>
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <utility>
 
 #include <broker/data.hh>
 
 #include "Reporter.h"
 
+#include "3rdparty/doctest.h"
+
 using namespace probabilistic;
 
+// Largest number of buckets that fits into the index part of a sparse
+// entry.
+static const uint64_t MAX_SPARSE_M = 1 << 24;
+
+// Returns 2^-r, for summing up the buckets without calling pow().
+static inline double neg_pow2(uint8_t r)
+	{
+	static const auto table = []
+		{
+		std::array<double, 256> t;
+
+		for ( int i = 0; i < 256; ++i )
+			t[i] = ldexp(1.0, -i);
+
+		return t;
+		}();
+
+	return table[r];
+	}
+
+// Whether a sparse list with n entries takes at least as much memory as
+// the dense array of m buckets.
+static inline bool sparse_too_large(uint64_t n, uint64_t m)
+	{
+	return n * sizeof(uint32_t) >= m;
+	}
+
 int CardinalityCounter::OptimalB(double error, double confidence) const
 	{
 	double initial_estimate = 2 * (log(1.04) - log(error)) / log(2);
@@ -58,22 +89,26 @@ void CardinalityCounter::Init(uint64_t size)
 
 	p = calc_p;
 
-	buckets.reserve(m);
-	for ( uint64_t i = 0; i < m; i++ )
-		buckets.push_back(0);
+	// Start out sparse; the bucket array gets allocated on demand.
+	is_sparse = m <= MAX_SPARSE_M;
 
-	assert(buckets.size() == m);
+	if ( ! is_sparse )
+		{
+		buckets.assign(m, 0);
+		assert(buckets.size() == m);
+		}
 
 	V = m;
 	}
 
 CardinalityCounter::CardinalityCounter(CardinalityCounter& other)
-	: buckets(other.buckets)
+	: buckets(other.buckets), sparse(other.sparse)
 	{
 	V = other.V;
 	alpha_m = other.alpha_m;
 	m = other.m;
 	p = other.p;
+	is_sparse = other.is_sparse;
 	}
 
 CardinalityCounter::CardinalityCounter(CardinalityCounter&& o)
@@ -82,9 +117,11 @@ CardinalityCounter::CardinalityCounter(CardinalityCounter&& o)
 	alpha_m = o.alpha_m;
 	m = o.m;
 	p = o.p;
+	is_sparse = o.is_sparse;
 
 	o.m = 0;
 	buckets = std::move(o.buckets);
+	sparse = std::move(o.sparse);
 	}
 
 CardinalityCounter::CardinalityCounter(double error_margin, double confidence)
@@ -103,10 +140,8 @@ CardinalityCounter::CardinalityCounter(uint64_t size)
 CardinalityCounter::CardinalityCounter(uint64_t arg_size, uint64_t arg_V, double arg_alpha_m)
 	{
 	m = arg_size;
-
-	buckets.reserve(m);
-	for ( uint64_t i = 0; i < m; i++ )
-		buckets.push_back(0);
+	is_sparse = false;
+	buckets.assign(m, 0);
 
 	alpha_m = arg_alpha_m;
 	V = arg_V;
@@ -131,13 +166,77 @@ void CardinalityCounter::AddElement(uint64_t hash)
 	uint64_t index = hash % m;
 	hash = hash-index;
 
-	if( buckets[index] == 0 )
-		V--;
+	SetBucket(index, Rank(hash));
+	}
+
+void CardinalityCounter::SetBucket(uint64_t index, uint8_t rank)
+	{
+	if ( ! is_sparse )
+		{
+		if ( buckets[index] == 0 )
+			V--;
+
+		if ( rank > buckets[index] )
+			buckets[index] = rank;
+
+		return;
+		}
+
+	uint32_t key = uint32_t(index) << 8;
+	auto it = std::lower_bound(sparse.begin(), sparse.end(), key);
+
+	if ( it != sparse.end() && (*it >> 8) == index )
+		{
+		if ( rank > (*it & 0xff) )
+			*it = key | rank;
+
+		return;
+		}
+
+	sparse.insert(it, key | rank);
+	V--;
+
+	if ( sparse_too_large(sparse.size(), m) )
+		ToDense();
+	}
+
+void CardinalityCounter::ToDense()
+	{
+	if ( ! is_sparse )
+		return;
+
+	buckets.assign(m, 0);
+
+	for ( auto e : sparse )
+		buckets[e >> 8] = e & 0xff;
+
+	sparse.clear();
+	sparse.shrink_to_fit();
+	is_sparse = false;
+	}
+
+void CardinalityCounter::MaybeToSparse()
+	{
+	if ( is_sparse || m > MAX_SPARSE_M )
+		return;
+
+	uint64_t used = m - std::count(buckets.begin(), buckets.end(), 0);
+
+	if ( sparse_too_large(used, m) )
+		return;
+
+	sparse.reserve(used);
 
-	uint8_t temp = Rank(hash);
+	for ( uint64_t i = 0; i < m; ++i )
+		{
+		if ( buckets[i] )
+			sparse.push_back((uint32_t(i) << 8) | buckets[i]);
+		}
 
-	if ( temp > buckets[index] )
-		buckets[index] = temp;
+	buckets.clear();
+	buckets.shrink_to_fit();
+	is_sparse = true;
+	V = m - used;
 	}
 
 /**
@@ -152,8 +251,20 @@ void CardinalityCounter::AddElement(uint64_t hash)
 double CardinalityCounter::Size() const
 	{
 	double answer = 0;
-	for ( unsigned int i = 0; i < m; i++ )
-		answer += pow(2, -((int)buckets[i]));
+
+	if ( is_sparse )
+		{
+		// Every unused bucket contributes 2^0.
+		answer = m - sparse.size();
+
+		for ( auto e : sparse )
+			answer += neg_pow2(e & 0xff);
+		}
+	else
+		{
+		for ( uint64_t i = 0; i < m; i++ )
+			answer += neg_pow2(buckets[i]);
+		}
 
 	answer = 1 / answer;
 	answer = (alpha_m * m * m * answer);
@@ -173,25 +284,27 @@ bool CardinalityCounter::Merge(CardinalityCounter* c)
 	if ( m != c->GetM() )
 		return false;
 
-	const vector<uint8_t> temp = c->GetBuckets();
-
-	V = 0;
-
-	for ( unsigned int i = 0; i < m; i++ )
+	if ( c->is_sparse )
 		{
-		if ( temp[i] > buckets[i] )
-			buckets[i] = temp[i];
+		// Only visit the buckets the other counter actually uses.
+		for ( auto e : c->sparse )
+			SetBucket(e >> 8, e & 0xff);
 
-		if ( buckets[i] == 0 )
-			++V;
+		return true;
 		}
 
-	return true;
-	}
+	ToDense();
 
-const vector<uint8_t> &CardinalityCounter::GetBuckets() const
-	{
-	return buckets;
+	// Kept free of branches so that the compiler can vectorize it.
+	uint8_t* dst = buckets.data();
+	const uint8_t* src = c->buckets.data();
+
+	for ( uint64_t i = 0; i < m; i++ )
+		dst[i] = std::max(dst[i], src[i]);
+
+	V = std::count(buckets.begin(), buckets.end(), 0);
+
+	return true;
 	}
 
 uint64_t CardinalityCounter::GetM() const
@@ -204,8 +317,29 @@ broker::expected<broker::data> CardinalityCounter::Serialize() const
 	broker::vector v = {m, V, alpha_m};
 	v.reserve(3 + m);
 
-	for ( size_t i = 0; i < m; ++i )
-		v.emplace_back(static_cast<uint64_t>(buckets[i]));
+	// Always send the dense layout, so that peers running older versions
+	// can still unserialize it.
+	if ( is_sparse )
+		{
+		size_t next = 0;
+
+		for ( auto e : sparse )
+			{
+			for ( ; next < (e >> 8); ++next )
+				v.emplace_back(static_cast<uint64_t>(0));
+
+			v.emplace_back(static_cast<uint64_t>(e & 0xff));
+			++next;
+			}
+
+		for ( ; next < m; ++next )
+			v.emplace_back(static_cast<uint64_t>(0));
+		}
+	else
+		{
+		for ( size_t i = 0; i < m; ++i )
+			v.emplace_back(static_cast<uint64_t>(buckets[i]));
+		}
 
 	return {std::move(v)};
 	}
@@ -240,6 +374,7 @@ std::unique_ptr<CardinalityCounter> CardinalityCounter::Unserialize(const broker
 		cc->buckets[i] = *x;
 		}
 
+	cc->MaybeToSparse();
 	return cc;
 	}
 
@@ -290,3 +425,215 @@ CardinalityCounter::flsll(uint64_t mask)
                 mask = (uint64_t)mask >> 1;
         return (bit);
 }
+
+namespace {
+
+// The counter as it was before it had a sparse representation, to
+// compare against.
+struct DenseCounter {
+	explicit DenseCounter(uint64_t arg_m)
+		: m(arg_m), buckets(arg_m, 0), V(arg_m), p(log2(arg_m))
+		{
+		alpha_m = 0.7213 / (1 + 1.079 / m);
+		}
+
+	void AddElement(uint64_t hash)
+		{
+		uint64_t index = hash % m;
+		hash = (hash - index) >> p;
+
+		int fls = 0;
+		for ( ; hash; hash >>= 1 )
+			++fls;
+
+		uint8_t rank = 64 - p - fls + 1;
+
+		if ( buckets[index] == 0 )
+			V--;
+
+		if ( rank > buckets[index] )
+			buckets[index] = rank;
+		}
+
+	void Merge(const DenseCounter& c)
+		{
+		for ( uint64_t i = 0; i < m; i++ )
+			buckets[i] = std::max(buckets[i], c.buckets[i]);
+
+		V = std::count(buckets.begin(), buckets.end(), 0);
+		}
+
+	double Size() const
+		{
+		double answer = 0;
+
+		for ( uint64_t i = 0; i < m; i++ )
+			answer += pow(2, -((int)buckets[i]));
+
+		answer = 1 / answer;
+		answer = (alpha_m * m * m * answer);
+
+		if ( answer <= 5.0 * (m/2) )
+			return m * log(((double)m) / V);
+
+		else if ( answer <= (pow(2, 64) / 30) )
+			return answer;
+
+		else
+			return -pow(2, 64) * log(1 - (answer / pow(2, 64)));
+		}
+
+	uint64_t m;
+	std::vector<uint8_t> buckets;
+	uint64_t V;
+	double alpha_m;
+	int p;
+};
+
+// splitmix64, for well-distributed element hashes.
+uint64_t next_hash(uint64_t* state)
+	{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+	}
+
+void add_elements(CardinalityCounter* cc, DenseCounter* d, uint64_t* state, int n)
+	{
+	for ( int i = 0; i < n; ++i )
+		{
+		uint64_t h = next_hash(state);
+		cc->AddElement(h);
+		d->AddElement(h);
+		}
+	}
+
+// Checks that the counter holds the same buckets and gives the same
+// estimate as the dense-only one.
+void check_same(const CardinalityCounter& cc, const DenseCounter& d)
+	{
+	CHECK(cc.Size() == doctest::Approx(d.Size()));
+
+	auto data = cc.Serialize();
+	REQUIRE(data);
+	auto v = caf::get_if<broker::vector>(&*data);
+	REQUIRE(v);
+	REQUIRE(v->size() == 3 + d.m);
+
+	auto V = caf::get_if<uint64_t>(&(*v)[1]);
+	REQUIRE(V);
+	CHECK(*V == d.V);
+
+	std::vector<uint8_t> buckets;
+
+	for ( size_t i = 3; i < v->size(); ++i )
+		{
+		auto x = caf::get_if<uint64_t>(&(*v)[i]);
+		REQUIRE(x);
+		buckets.push_back(*x);
+		}
+
+	CHECK(buckets == d.buckets);
+	}
+
+}
+
+TEST_CASE("cardinality counter sparse to dense promotion")
+	{
+	// With 1024 buckets, the counter turns dense once 256 are in use,
+	// which takes about 290 elements.
+	CardinalityCounter cc(uint64_t(1024));
+	DenseCounter d(1024);
+	uint64_t state = 1;
+
+	check_same(cc, d);
+
+	for ( int i = 0; i < 100; ++i )
+		{
+		add_elements(&cc, &d, &state, 5);
+		check_same(cc, d);
+		}
+
+	add_elements(&cc, &d, &state, 100000);
+	check_same(cc, d);
+	}
+
+TEST_CASE("cardinality counter merge")
+	{
+	CardinalityCounter sparse1(uint64_t(1024));
+	CardinalityCounter sparse2(uint64_t(1024));
+	CardinalityCounter dense(uint64_t(1024));
+	DenseCounter d_sparse1(1024);
+	DenseCounter d_sparse2(1024);
+	DenseCounter d_dense(1024);
+	uint64_t state = 2;
+
+	add_elements(&sparse1, &d_sparse1, &state, 100);
+	add_elements(&sparse2, &d_sparse2, &state, 200);
+	add_elements(&dense, &d_dense, &state, 5000);
+
+	SUBCASE("sparse into dense")
+		{
+		CHECK(dense.Merge(&sparse1));
+		d_dense.Merge(d_sparse1);
+		check_same(dense, d_dense);
+		}
+
+	SUBCASE("dense into sparse")
+		{
+		CHECK(sparse1.Merge(&dense));
+		d_sparse1.Merge(d_dense);
+		check_same(sparse1, d_sparse1);
+		}
+
+	SUBCASE("sparse into sparse")
+		{
+		// Together they use more buckets than a sparse counter keeps.
+		CHECK(sparse1.Merge(&sparse2));
+		d_sparse1.Merge(d_sparse2);
+		check_same(sparse1, d_sparse1);
+
+		add_elements(&sparse1, &d_sparse1, &state, 1000);
+		check_same(sparse1, d_sparse1);
+		}
+
+	SUBCASE("different sizes")
+		{
+		CardinalityCounter other(uint64_t(2048));
+		CHECK_FALSE(sparse1.Merge(&other));
+		CHECK_FALSE(dense.Merge(&other));
+		}
+	}
+
+TEST_CASE("cardinality counter serialization")
+	{
+	CardinalityCounter cc(uint64_t(1024));
+	DenseCounter d(1024);
+	uint64_t state = 3;
+
+	SUBCASE("sparse")
+		{
+		add_elements(&cc, &d, &state, 100);
+		}
+
+	SUBCASE("dense")
+		{
+		add_elements(&cc, &d, &state, 5000);
+		}
+
+	auto data = cc.Serialize();
+	REQUIRE(data);
+
+	auto cc2 = CardinalityCounter::Unserialize(*data);
+	REQUIRE(cc2);
+	check_same(*cc2, d);
+
+	auto data2 = cc2->Serialize();
+	REQUIRE(data2);
+	CHECK(*data2 == *data);
+
+	// The unserialized counter keeps counting (and promoting) correctly.
+	add_elements(cc2.get(), &d, &state, 1000);
+	check_same(*cc2, d);
+	}
@@ -15,6 +15,12 @@ namespace probabilistic {
 
 /**
  * A probabilistic cardinality counter using the HyperLogLog algorithm.
+ *
+ * As long as only few buckets are in use, the counter keeps them in a
+ * sparse list rather than the full bucket array, which makes nearly
+ * empty counters much smaller and cheaper to merge. Once the sparse
+ * list would take as much memory as the array, the counter switches
+ * to the dense representation for good.
  */
 class CardinalityCounter {
 public:
@@ -100,16 +106,6 @@ protected:
 	 */
 	uint64_t GetM() const;
 
-	/**
-	 * Returns the buckets array that holds all of the rough cardinality
-	 * estimates.
-	 *
-	 * Use GetM() to determine the size.
-	 *
-	 * @return Array containing cardinality estimates
-	 */
-	const std::vector<uint8_t>& GetBuckets() const;
-
 private:
 	/**
 	 * Constructor used when unserializing, i.e., all parameters are
@@ -155,6 +151,23 @@ private:
 	 */
 	uint8_t Rank(uint64_t hash_modified) const;
 
+	/**
+	 * Raises the bucket at the given index to the given rank, if it is
+	 * currently lower. Works on either representation.
+	 */
+	void SetBucket(uint64_t index, uint8_t rank);
+
+	/**
+	 * Switches from the sparse to the dense representation.
+	 */
+	void ToDense();
+
+	/**
+	 * Switches to the sparse representation if few enough buckets are
+	 * in use.
+	 */
+	void MaybeToSparse();
+
 	/**
 	 * flsll from FreeBSD; especially Linux does not have this.
 	 */
@@ -175,6 +188,15 @@ private:
 	 */
 	std::vector<uint8_t> buckets;
 
+	/**
+	 * The buckets in use while the counter is sparse, sorted by index.
+	 * Each entry holds the bucket index in its upper 24 bits and the
+	 * bucket's value in its lower 8 bits. buckets is empty while the
+	 * counter is sparse.
+	 */
+	std::vector<uint32_t> sparse;
+	bool is_sparse;
+
 	/**
 	 * There are some state constants that need to be kept track of to
 	 * make the final estimate easier. V is the number of values in
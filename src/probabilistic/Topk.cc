@@ -2,6 +2,8 @@
 
 #include "probabilistic/Topk.h"
 
+#include <iterator>
+
 #include <broker/error.hh>
 
 #include "broker/Data.h"
@@ -21,6 +23,7 @@ static void topk_element_hash_delete_func(void* val)
 Element::~Element()
 	{
 	Unref(value);
+	delete key;
 	}
 
 void TopkVal::Typify(BroType* t)
@@ -121,6 +124,7 @@ void TopkVal::Merge(const TopkVal* value, bool doPrune)
 				olde = new Element();
 				olde->epsilon = 0;
 				olde->value = e->value->Ref();
+				olde->key = key;
 				// insert at bucket position 0
 				if ( buckets.size() > 0 )
 					{
@@ -131,20 +135,19 @@ void TopkVal::Merge(const TopkVal* value, bool doPrune)
 				newbucket->count = 0;
 				newbucket->bucketPos = buckets.insert(buckets.begin(), newbucket);
 
-				olde->parent = newbucket;
-				newbucket->elements.insert(newbucket->elements.end(), olde);
+				AddToBucket(newbucket, olde);
 
 				elementDict->Insert(key, olde);
 				numElements++;
-
 				}
+			else
+				delete key;
 
 			// now that we are sure that the old element is present - increment epsilon
 			olde->epsilon += e->epsilon;
 
 			// and increment position...
 			IncrementCounter(olde, currcount);
-			delete key;
 
 			eit++;
 			}
@@ -168,12 +171,9 @@ void TopkVal::Merge(const TopkVal* value, bool doPrune)
 		assert(b->elements.size() > 0);
 
 		Element* e = b->elements.front();
-		HashKey* key = GetHash(e->value);
-		elementDict->RemoveEntry(key);
-		delete key;
-		delete e;
-
+		elementDict->RemoveEntry(e->key);
 		b->elements.pop_front();
+		delete e;
 
 		if ( b->elements.size() == 0 )
 			{
@@ -301,6 +301,7 @@ void TopkVal::Encountered(Val* encountered)
 		e = new Element();
 		e->epsilon = 0;
 		e->value = encountered->Ref(); // or no ref?
+		e->key = key;
 
 		// well, we do not know this one yet...
 		if ( numElements < size )
@@ -312,20 +313,17 @@ void TopkVal::Encountered(Val* encountered)
 				b->count = 1;
 				std::list<Bucket*>::iterator pos = buckets.insert(buckets.begin(), b);
 				b->bucketPos = pos;
-				b->elements.insert(b->elements.end(), e);
-				e->parent = b;
+				AddToBucket(b, e);
 				}
 			else
 				{
 				Bucket* b = *buckets.begin();
 				assert(b->count == 1);
-				b->elements.insert(b->elements.end(), e);
-				e->parent = b;
+				AddToBucket(b, e);
 				}
 
 			elementDict->Insert(key, e);
 			numElements++;
-			delete key;
 
 			return; // done. it is at pos 1.
 			}
@@ -337,29 +335,34 @@ void TopkVal::Encountered(Val* encountered)
 
 			// evict oldest element with least hits.
 			assert(b->elements.size() > 0);
-			HashKey* deleteKey = GetHash((*(b->elements.begin()))->value);
-			b->elements.erase(b->elements.begin());
-			Element* deleteElement = (Element*) elementDict->RemoveEntry(deleteKey);
-			assert(deleteElement); // there has to have been a minimal element...
+			Element* deleteElement = b->elements.front();
+			b->elements.pop_front();
+			Element* removed = (Element*) elementDict->RemoveEntry(deleteElement->key);
+			assert(removed == deleteElement); // there has to have been a minimal element...
 			delete deleteElement;
-			delete deleteKey;
 
 			// and add the new one to the end
 			e->epsilon = b->count;
-			b->elements.insert(b->elements.end(), e);
+			AddToBucket(b, e);
 			elementDict->Insert(key, e);
-			e->parent = b;
 
 			// fallthrough, increment operation has to run!
 			}
 
 		}
+	else
+		delete key;
 
 	// ok, we now have an element in e
-	delete key;
 	IncrementCounter(e); // well, this certainly was anticlimatic.
 	}
 
+void TopkVal::AddToBucket(Bucket* b, Element* e)
+	{
+	e->elementPos = b->elements.insert(b->elements.end(), e);
+	e->parent = b;
+	}
+
 // increment by count
 void TopkVal::IncrementCounter(Element* e, unsigned int count)
 	{
@@ -379,6 +382,15 @@ void TopkVal::IncrementCounter(Element* e, unsigned int count)
 	if ( bucketIter != buckets.end() && (*bucketIter)->count == currcount+count )
 		nextBucket = *bucketIter;
 
+	if ( nextBucket == 0 && currBucket->elements.size() == 1 &&
+	     bucketIter == std::next(currBucket->bucketPos) )
+		{
+		// We're alone in our bucket and the new count belongs
+		// right where it is, so just update the count in place.
+		currBucket->count = currcount+count;
+		return;
+		}
+
 	if ( nextBucket == 0 )
 		{
 		// the bucket for the value that we want does not exist.
@@ -393,16 +405,17 @@ void TopkVal::IncrementCounter(Element* e, unsigned int count)
 		nextBucket = b;
 		}
 
-	// ok, now we have the new bucket in nextBucket. Shift the element over...
-	currBucket->elements.remove(e);
-	nextBucket->elements.insert(nextBucket->elements.end(), e);
+	// ok, now we have the new bucket in nextBucket. Shift the element
+	// over; splicing keeps e->elementPos valid and allocates nothing.
+	nextBucket->elements.splice(nextBucket->elements.end(),
+	                            currBucket->elements, e->elementPos);
 
 	e->parent = nextBucket;
 
 	// if currBucket is empty, we have to delete it now
 	if ( currBucket->elements.size() == 0 )
 		{
-		buckets.remove(currBucket);
+		buckets.erase(currBucket->bucketPos);
 		delete currBucket;
 		currBucket = 0;
 		}
@@ -513,15 +526,13 @@ bool TopkVal::DoUnserialize(const broker::data& data)
 			Element* e = new Element();
 			e->epsilon = *epsilon;
 			e->value = val.detach();
-			e->parent = b;
-
-			b->elements.insert(b->elements.end(), e);
+			AddToBucket(b, e);
 
 			HashKey* key = GetHash(e->value);
 			assert (elementDict->Lookup(key) == 0);
 
+			e->key = key;
 			elementDict->Insert(key, e);
-			delete key;
 
 			i++;
 			}
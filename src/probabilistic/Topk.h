@@ -29,6 +29,15 @@ struct Element {
 	Val* value;
 	Bucket* parent;
 
+	// Our position in parent->elements, so that we can be unlinked
+	// and moved between buckets without searching for us.
+	std::list<Element*>::iterator elementPos;
+
+	// Cached so that evicting us doesn't require hashing value again.
+	// This is the key we were inserted into the element dictionary
+	// with; the dictionary owns the key bytes it references.
+	HashKey* key;
+
 	~Element();
 };
 
@@ -146,6 +155,15 @@ private:
 	 */
 	void IncrementCounter(Element* e, unsigned int count = 1);
 
+	/**
+	 * Append an element to a bucket.
+	 *
+	 * @param b bucket to add the element to
+	 *
+	 * @param e element to add
+	 */
+	void AddToBucket(Bucket* b, Element* e);
+
 	/**
 	 * get the hashkey for a specific value
 	 *